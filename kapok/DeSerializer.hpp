@@ -1,7 +1,18 @@
 #pragma once
 #include "JsonUtil.hpp"
 #include "traits.hpp"
-#include <boost/lexical_cast.hpp>
+#include "PerfectHash.hpp"
+#include "KeyCast.hpp"
+#include "VariantAccess.hpp"
+#include "Error.hpp"
+#include "Parallel.hpp"
+#include "MappedFile.hpp"
+#include "rapidjson/error/en.h"
+#include <algorithm>
+#include <bitset>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
 
 namespace kapok {
 class DeSerializer : NonCopyable
@@ -29,13 +40,180 @@ public:
 
 	void Parse(const char* jsonText, std::size_t length)
 	{
-		m_jsutil.Parse(jsonText, length);
+		if (!TryParse(jsonText, length))
+			KAPOK_THROW(std::invalid_argument(m_error.message));
 	}
 
-    rapidjson::Document&  GetDocument()
+	//parses a buffer that cannot be modified without copying it, only the strings are copied into
+	//the document. The buffer is not needed after the parse.
+	void ParseCopy(const char* jsonText, std::size_t length)
+	{
+		if (!TryParseCopy(jsonText, length))
+			KAPOK_THROW(std::invalid_argument(m_error.message));
+	}
+
+	//parses the buffer in place, without copying it or the strings. The buffer is modified, and the
+	//boost::string_ref/std::string_view members of the deserialized objects point into it.
+	void ParseInsitu(char* jsonText, std::size_t length)
+	{
+		if (!TryParseInsitu(jsonText, length))
+			KAPOK_THROW(std::invalid_argument(m_error.message));
+	}
+
+	void ParseInsitu(char* jsonText)
+	{
+		if (!TryParseInsitu(jsonText))
+			KAPOK_THROW(std::invalid_argument(m_error.message));
+	}
+
+	//parses the file without reading it into a string: it is mapped read-only and parsed from the
+	//mapping like ParseCopy, which is released before returning since the document copies the strings.
+	void ParseFile(const char* path)
+	{
+		if (!TryParseFile(path))
+			KAPOK_THROW(std::invalid_argument(m_error.message));
+	}
+
+	void ParseFile(const std::string& path)
+	{
+		ParseFile(path.c_str());
+	}
+
+	//maps a private copy-on-write view of the file and parses it in place like ParseInsitu, the file
+	//is not modified. The strings are written back into the view, so almost every page ends up
+	//copied (see MappedFile). The document and the views point into the mapping, it is kept until
+	//the next Parse, Reset or Trim.
+	void ParseFileInsitu(const char* path)
+	{
+		if (!TryParseFileInsitu(path))
+			KAPOK_THROW(std::invalid_argument(m_error.message));
+	}
+
+	void ParseFileInsitu(const std::string& path)
+	{
+		ParseFileInsitu(path.c_str());
+	}
+
+	//the Try versions return false instead of throwing, GetError then holds the code, the message
+	//and the byte offset of the failure.
+	bool TryParse(const std::string& jsonText)
+	{
+		return TryParse(jsonText.c_str(), jsonText.length());
+	}
+
+	bool TryParse(const char* jsonText, std::size_t length)
+	{
+		m_file.Close();
+		return SetParseResult(m_jsutil.Parse(jsonText, length));
+	}
+
+	bool TryParseCopy(const char* jsonText, std::size_t length)
+	{
+		m_file.Close();
+		return SetParseResult(m_jsutil.ParseCopy(jsonText, length));
+	}
+
+	bool TryParseInsitu(char* jsonText, std::size_t length)
+	{
+		m_file.Close();
+		return SetParseResult(m_jsutil.ParseInsitu(jsonText, length));
+	}
+
+	bool TryParseInsitu(char* jsonText)
+	{
+		m_file.Close();
+		return SetParseResult(m_jsutil.ParseInsitu(jsonText));
+	}
+
+	bool TryParseFile(const char* path)
+	{
+		if (!OpenFile(path, false))
+			return false;
+
+		bool ok = SetParseResult(m_jsutil.ParseCopy(m_file.Data(), m_file.Size()));
+		m_file.Close();
+		return ok;
+	}
+
+	bool TryParseFileInsitu(const char* path)
+	{
+		return OpenFile(path, true) && SetParseResult(m_jsutil.ParseInsitu(m_file.Data(), m_file.Size()));
+	}
+
+	//the error of the last Parse or Deserialize, with the json pointer of the failed value.
+	const Error& GetError() const
+	{
+		return m_error;
+	}
+
+	Document& GetDocument()
 	{
 		return m_jsutil.GetDocument();
 	}
+
+	//releases the document of the last message, the arena and the stack buffer are kept.
+	void Reset()
+	{
+		m_jsutil.GetPool().Reset();
+		m_file.Close();
+	}
+
+	//the values of the document are allocated from an arena of arena_size bytes kept between the
+	//messages, the rest from chunks of chunk_size bytes which are freed by the next Parse or Reset.
+	void SetArena(size_t arena_size, size_t chunk_size = DocumentPool::default_chunk_size)
+	{
+		m_jsutil.GetPool().SetArena(arena_size, chunk_size);
+	}
+
+	//the parse stack of the document uses the caller's buffer, which must outlive the DeSerializer.
+	void SetStackBuffer(void* buffer, size_t size)
+	{
+		m_jsutil.GetPool().SetStackBuffer(buffer, size);
+	}
+
+	//once a message grew the copy of the json text over threshold bytes, the next Parse shrinks it
+	//to size bytes. The chunks of the document are always freed by the next Parse.
+	void SetTrimPolicy(size_t threshold, size_t size)
+	{
+		m_jsutil.SetTrimPolicy(threshold, size);
+	}
+
+	//releases the document and the copy of the json text now.
+	void Trim()
+	{
+		m_jsutil.TrimDocument();
+		m_file.Close();
+	}
+
+	//the bytes kept between the messages: the copy of the json text, the arena, the chunks and the stack buffer.
+	size_t GetReservedBytes() const
+	{
+		return m_jsutil.GetReserved();
+	}
+
+	//float members and elements read the float nearest to their text even when its double is in
+	//the middle of two floats, like 7.038531e-26 which the Serializer writes for 7.038531e-26f.
+	//Without it they read the correctly rounded double rounded to float, which can be one float
+	//off for those few numbers. The SaxDeSerializer always converts the float from the text.
+	void SetExactFloats(bool exact)
+	{
+		m_jsutil.SetExactFloats(exact);
+	}
+
+	//the arrays of at least min_elements elements read into a vector, a deque, a std::array or a C
+	//array are read by threads workers (0 means one per core, 1 turns it off). The target is
+	//resized once, each worker reads slices of the elements in place from the document, which is
+	//only read. The result and the error are the ones of one thread. The worker threads and their
+	//DeSerializers are created by the first array read in parallel and kept until the next SetParallel.
+	void SetParallel(size_t threads, size_t min_elements = parallel_min_elements)
+	{
+		m_threads = detail::thread_count(threads);
+		m_parallel_min = min_elements;
+		m_workers.reset();
+		m_pool.reset();
+	}
+
+	static const size_t parallel_min_elements = 10000;
 	
 	template<typename T>
 	void Deserialize(T& t, const std::string& key, bool has_root = true)
@@ -46,68 +224,112 @@ public:
 	template<typename T>
 	void Deserialize(T& t, const char* key, bool has_root = true)
 	{
-        rapidjson::Value& jsonval = GetRootValue(key, has_root);
-
-		ReadObject(t, jsonval, std::true_type{});
+		if (!TryDeserialize(t, key, has_root))
+			KAPOK_THROW(std::invalid_argument(m_error.message));
 	}
 
 	template<typename T>
 	void Deserialize(T& t, bool has_root = false)
 	{
-        rapidjson::Value& jsonval = GetRootValue(nullptr, has_root);
+		Deserialize(t, nullptr, has_root);
+	}
 
-		ReadObject(t, jsonval, std::true_type{});
+	template<typename T>
+	bool TryDeserialize(T& t, const std::string& key, bool has_root = true)
+	{
+		return TryDeserialize(t, key.c_str(), has_root);
 	}
 
-	template <typename T, size_t N>
-	void Deserialize(T(&p)[N], const char* key)
+	//the members read before the failure keep their values.
+	template<typename T>
+	bool TryDeserialize(T& t, const char* key, bool has_root = true)
 	{
-		ReadArray<T>(p, key);
+		m_error.Clear();
+		Document& doc = m_jsutil.GetDocument();
+		if (!has_root)
+		{
+			ReadObject(t, doc, std::true_type{});
+			return !m_error;
+		}
+
+		//without a key the root is the first member.
+		auto it = doc.IsObject() ? (key == nullptr ? doc.MemberBegin() : doc.FindMember(key)) : rapidjson::Value::MemberIterator();
+		if (!doc.IsObject() || it == doc.MemberEnd())
+		{
+			Fail(ErrorCode::key_not_found, "the key is not exist");
+			return false;
+		}
+
+		ReadObject(t, it->value, std::true_type{});
+		if (m_error)
+			PrependKey(it->name);
+
+		return !m_error;
 	}
 
-	template<typename T, size_t N>
-	void Deserialize(std::array<T, N>& arr, const char* key)
+	template<typename T>
+	bool TryDeserialize(T& t, bool has_root = false)
 	{
-		ReadArray<T>(arr, key);
+		return TryDeserialize(t, nullptr, has_root);
 	}
 
 private:
-    rapidjson::Value& GetRootValue(const char* key, bool has_root = true)
+	//the document may point into the closed mapping, it is dropped when the file fails to open.
+	bool OpenFile(const char* path, bool writable)
 	{
-        rapidjson::Document& doc = m_jsutil.GetDocument();
-		if (!has_root)
-			return doc;
+		m_file.Close();
+		m_error.Clear();
+		const char* error = m_file.Open(path, writable);
+		if (error == nullptr)
+			return true;
 
-		if (key == nullptr)
-		{
-			auto it = doc.MemberBegin();
-			return (rapidjson::Value&)it->value;
-		}
-			
-		if (!doc.HasMember(key))
-			throw std::invalid_argument("the key is not exist");
+		m_jsutil.GetPool().Reset();
+		m_error.Set(ErrorCode::file_error, error);
+		return false;
+	}
 
-		return doc[key];
+	bool SetParseResult(rapidjson::ParseResult result)
+	{
+		m_error.Clear();
+		if (result.IsError())
+			m_error.Set(ErrorCode::parse_error, rapidjson::GetParseError_En(result.Code()), result.Offset());
+
+		return !result.IsError();
 	}
-	
-	template<typename value_type, typename T>
-	void ReadArray(T& t, const char* key)
+
+	//the errors are recorded, not thrown: the readers return at once and each level prepends its
+	//key or index to the path on the way out.
+	void Fail(ErrorCode code, const char* message)
 	{
-        rapidjson::Value& jsonval = GetRootValue(key);
+		m_error.Set(code, message);
+	}
 
-		ReadArray<value_type>(t, jsonval);
+	void PrependKey(const rapidjson::Value& name)
+	{
+		m_error.PrependKey(name.GetString(), name.GetStringLength());
 	}
 
-	template<typename value_type, typename T>
-	void ReadArray(T& t, rapidjson::Value& jsonval)
+	//null leaves the target as it is.
+	bool ExpectArray(const rapidjson::Value& v)
 	{
-		size_t sz = jsonval.Size();
-		for (rapidjson::SizeType i = 0; i < sz; i++)
-		{
-			value_type value;
-			ReadValue(value, jsonval[i], std::true_type{});
-			t[i] = value;
-		}
+		if (v.IsArray())
+			return true;
+
+		if (!v.IsNull())
+			Fail(ErrorCode::type_mismatch, "should be array");
+
+		return false;
+	}
+
+	bool ExpectObject(const rapidjson::Value& v)
+	{
+		if (v.IsObject())
+			return true;
+
+		if (!v.IsNull())
+			Fail(ErrorCode::type_mismatch, "should be object");
+
+		return false;
 	}
 
 	template<typename T, typename BeginObject>
@@ -119,7 +341,58 @@ private:
 	template<typename T, typename BeginObject>
 	typename std::enable_if<is_user_class<T>::value>::type ReadObject(T& t, rapidjson::Value& val, BeginObject)
 	{
+#ifdef KAPOK_LINEAR_FIELD_LOOKUP
 		ReadTuple(t.Meta(), val, std::false_type{});
+#else
+		ReadFields(t, val, std::integral_constant<bool, detail::has_meta_names<T>::value>{});
+#endif
+	}
+
+	template<typename T>
+	void ReadFields(T& t, rapidjson::Value& val, std::false_type)
+	{
+		ReadTuple(t.Meta(), val, std::false_type{});
+	}
+
+	//one pass over the members, each member name is mapped to its field by the perfect hash of META.
+	//A duplicate key is skipped, the field keeps the first value like a FindMember lookup.
+	template<typename T>
+	void ReadFields(T& t, rapidjson::Value& val, std::true_type)
+	{
+		if (val.IsArray())
+			return Fail(ErrorCode::type_mismatch, "should not be array");
+
+		if (!val.IsObject())
+			return;
+
+		auto tp = t.Meta();
+		std::bitset<field_table<T>::size> read;
+		for (auto it = val.MemberBegin(); it != val.MemberEnd(); ++it)
+		{
+			size_t index = field_table<T>::find(it->name.GetString(), it->name.GetStringLength());
+			if (index == field_table<T>::npos || read.test(index))
+				continue;
+
+			read.set(index);
+
+			ReadField(tp, index, it->value, std::make_index_sequence<field_table<T>::size>{});
+			if (m_error)
+				return PrependKey(it->name);
+		}
+	}
+
+	template<typename Tuple, size_t... Is>
+	void ReadField(Tuple& tp, size_t index, rapidjson::Value& val, std::index_sequence<Is...>)
+	{
+		using reader_t = void(*)(DeSerializer&, Tuple&, rapidjson::Value&);
+		static const reader_t readers[] = { &ReadFieldAt<Is, Tuple>... };
+		readers[index](*this, tp, val);
+	}
+
+	template<size_t I, typename Tuple>
+	static void ReadFieldAt(DeSerializer& dr, Tuple& tp, rapidjson::Value& val)
+	{
+		dr.ReadObject(std::get<I>(tp), val, std::false_type{});
 	}
 
 	template <typename T, typename BeginObject>
@@ -135,149 +408,347 @@ private:
 	{
 		if (!val.IsNull())
 		{
-			std::remove_reference_t<decltype(*t)> tmp;
-			ReadObject(tmp, val, std::true_type{});
-			t = tmp;
+			t.emplace();
+			ReadObject(*t, val, std::true_type{});
 		}
 	}
 
-	template <typename BeginObject, typename ... Args>
-	void ReadObject(variant<Args...>& v, rapidjson::Value& value, BeginObject)
+	template <typename T, typename BeginObject>
+	auto ReadObject(T& v, rapidjson::Value& value, BeginObject) -> std::enable_if_t<is_variant<T>::value>
 	{
 		if (!value.IsObject() || value.MemberCount() != 1)
-			throw std::invalid_argument{ "Should be an object with one member" };
+			return Fail(ErrorCode::member_count, "Should be an object with one member");
 
 		auto object = value.MemberBegin();
+		size_t index = 0;
+		if (detail::key_cast(object->name.GetString(), object->name.GetStringLength(), index) != nullptr
+			|| index >= detail::variant_access<T>::size)
+			return Fail(ErrorCode::variant_index, "Wrong variant types.");
 
-		auto index = boost::lexical_cast<size_t>(
-			object->name.GetString(), object->name.GetStringLength());
+		ReadAlternative(v, index, object->value, std::make_index_sequence<detail::variant_access<T>::size>{});
+		if (m_error)
+			PrependKey(object->name);
+	}
 
-		LoadVariant(object->value, index, v);
-		//LoadVariant(value, index, v);
+	//the reader of the alternative is picked by index from a table.
+	template<typename T, size_t... Is>
+	void ReadAlternative(T& v, size_t index, rapidjson::Value& val, std::index_sequence<Is...>)
+	{
+		using reader_t = void(*)(DeSerializer&, T&, rapidjson::Value&);
+		static const reader_t readers[] = { &ReadAlternativeAt<Is, T>... };
+		readers[index](*this, v, val);
 	}
 
-	template<typename Tuple, typename BeginObject>
-	void ReadTuple(Tuple&& tp, rapidjson::Value& val, BeginObject bo)
+	template<size_t I, typename T>
+	static void ReadAlternativeAt(DeSerializer& dr, T& v, rapidjson::Value& val)
 	{
-		const int size = std::tuple_size<Tuple>::value;
-		
-		for (rapidjson::SizeType j = 0; j < size; j++)
+		using value_type = typename detail::variant_access<T>::template alternative<I>;
+		detail::variant_access<T>::template assign<I>(v, [&dr, &val](value_type& value)
 		{
-			SetValueByIndex(j, tp, val, bo);
-		}
+			dr.ReadObject(value, val, std::true_type{});
+		});
 	}
 
-	template<size_t k=0, typename Tuple, typename BeginObject>
-	inline auto SetValueByIndex(size_t, Tuple&, rapidjson::Value&, BeginObject) ->
-		std::enable_if_t<(k == std::tuple_size<Tuple>::value)>
+	template<typename Tuple, typename BeginObject>
+	void ReadTuple(Tuple&& tp, rapidjson::Value& val, BeginObject bo)
 	{
-		throw std::invalid_argument("arg index out of range");
+		using tuple_t = std::remove_reference_t<Tuple>;
+		ReadTuple(tp, val, bo, std::make_index_sequence<std::tuple_size<tuple_t>::value>{});
 	}
 
-	template<size_t k = 0, typename Tuple, typename BeginObject>
-	inline auto SetValueByIndex(size_t index, Tuple& tp, rapidjson::Value& val, BeginObject bo) ->
-		std::enable_if_t<(k < std::tuple_size<Tuple>::value)>
+	//every element is visited exactly once.
+	template<typename Tuple, typename BeginObject, size_t... Is>
+	void ReadTuple(Tuple& tp, rapidjson::Value& val, BeginObject bo, std::index_sequence<Is...>)
 	{
-		if (k == index)
-		{
-			ReadValue<k>(tp, val, bo);
-		}
-		else
-		{
-			SetValueByIndex<k + 1>(index, tp, val, bo);
-		}
+		(void)std::initializer_list<int>{ (ReadValue<Is>(tp, val, bo), 0)... };
 	}
 
+	//the adaptors are filled through their underlying container, a priority_queue is heapified once
+	//at the end, the json array of a stack starts from the top which is the back of the container.
 	template<typename T, typename BeginObject>
 	auto ReadObject(T&& t, rapidjson::Value& v, BeginObject) ->
-		std::enable_if_t<is_stack<T>::value>
+		std::enable_if_t<is_stack<T>::value || is_container_adapter<T>::value>
 	{
 		using U = typename std::decay<T>::type;
 
-		size_t sz = v.Size();
-		for (rapidjson::SizeType i = sz; i > 0; i--)
+		if (!ExpectArray(v))
+			return;
+
+		auto& c = detail::adaptor_access<U>::container(t);
+		rapidjson::SizeType sz = v.Size();
+		Reserve(c, sz, 0);
+		for (rapidjson::SizeType i = 0; i < sz; i++)
 		{
-			typename U::value_type value;
-			ReadObject(value, v[i - 1], std::true_type{});
-			push(t, value, i-1);
+			const rapidjson::SizeType index = is_stack<U>::value ? sz - 1 - i : i;
+			c.emplace_back();
+			ReadObject(c.back(), v[index], std::true_type{});
+			if (m_error)
+				return m_error.PrependIndex(index);
 		}
+
+		MakeHeap(t);
+	}
+
+	template<typename T>
+	auto MakeHeap(T& t) -> std::enable_if_t<is_priority_queue<T>::value>
+	{
+		//the json written by the serializer is in heap order already.
+		auto& c = detail::adaptor_access<T>::container(t);
+		auto& comp = detail::adaptor_access<T>::compare(t);
+		if (!std::is_heap(c.begin(), c.end(), comp))
+			std::make_heap(c.begin(), c.end(), comp);
+	}
+
+	template<typename T>
+	auto MakeHeap(T&) -> std::enable_if_t<!is_priority_queue<T>::value>
+	{
 	}
 
 	template<typename T, typename BeginObject>
 	auto ReadObject(T&& t, rapidjson::Value& v, BeginObject) ->
-		std::enable_if_t<is_singlevalue_container<T>::value || is_container_adapter<T>::value>
+		std::enable_if_t<is_singlevalue_container<T>::value>
 	{
 		using U = typename std::decay<T>::type;
 
-		size_t sz = v.Size();
+		if (!ExpectArray(v))
+			return;
+
+		rapidjson::SizeType sz = v.Size();
+		Reserve(t, sz, 0);
+		ReadElements(t, v, sz, std::integral_constant<bool, is_back_emplaceable<U>::value>{});
+	}
+
+	//the elements are constructed at the back and read in place, a vector<bool> element is not addressable.
+	template<typename T>
+	using is_back_emplaceable = std::integral_constant<bool, !is_set<T>::value && !is_multiset<T>::value
+		&& !is_unordered_set<T>::value && !std::is_same<typename T::value_type, bool>::value>;
+
+	template<typename T>
+	using is_random_access = std::is_same<typename std::iterator_traits<typename T::iterator>::iterator_category, std::random_access_iterator_tag>;
+
+	template<typename T>
+	void ReadElements(T& t, rapidjson::Value& v, rapidjson::SizeType sz, std::true_type)
+	{
+		if (is_random_access<T>::value && IsParallel(sz))
+			return ReadResized(t, v, sz, is_random_access<T>{});
+
 		for (rapidjson::SizeType i = 0; i < sz; i++)
 		{
-			typename U::value_type value;
+			t.emplace_back();
+			ReadObject(t.back(), v[i], std::true_type{});
+			if (m_error)
+				return m_error.PrependIndex(i);
+		}
+	}
+
+	template<typename T>
+	void ReadElements(T& t, rapidjson::Value& v, rapidjson::SizeType sz, std::false_type)
+	{
+		for (rapidjson::SizeType i = 0; i < sz; i++)
+		{
+			typename T::value_type value;
 			ReadObject(value, v[i], std::true_type{});
-			push(t, value, i);
+			if (m_error)
+				return m_error.PrependIndex(i);
+
+			push(t, std::move(value));
 		}
 	}
 
+	//the elements after a failed one are dropped as if they were read one by one.
+	template<typename T>
+	void ReadResized(T& t, rapidjson::Value& v, size_t sz, std::true_type)
+	{
+		const size_t first = t.size();
+		t.resize(first + sz);
+		const size_t failed = ReadParallel(v, sz, [&t, first](DeSerializer& dr, rapidjson::Value& e, size_t i)
+		{
+			dr.ReadObject(t[first + i], e, std::true_type{});
+		});
+
+		if (failed != npos)
+			t.resize(first + failed + 1);
+	}
+
+	template<typename T>
+	void ReadResized(T&, rapidjson::Value&, size_t, std::false_type)
+	{
+	}
+
+	bool IsParallel(size_t sz) const
+	{
+		return m_threads > 1 && sz >= m_parallel_min;
+	}
+
+	//the elements are cut into four slices per worker, each slice keeps its first error. The error
+	//of the first failed slice becomes the error, its index is the result.
+	template<typename Read>
+	size_t ReadParallel(rapidjson::Value& v, size_t count, Read read)
+	{
+		if (!m_pool)
+		{
+			m_workers.reset(new DeSerializer[m_threads]);
+			for (size_t i = 0; i < m_threads; i++)
+				m_workers[i].m_jsutil.ShareFloats(m_jsutil);
+
+			m_pool.reset(new ThreadPool(m_threads));
+		}
+
+		const size_t slices = (std::min)(m_threads * 4, count);
+		if (m_slices.size() < slices)
+			m_slices.resize(slices);
+
+		m_pool->Run(slices, [this, &v, &read, count, slices](size_t s, size_t worker)
+		{
+			DeSerializer& dr = m_workers[worker];
+			SliceError& slice = m_slices[s];
+			dr.m_error.Clear();
+			slice.index = npos;
+			for (size_t i = count * s / slices, end = count * (s + 1) / slices; i < end; i++)
+			{
+				read(dr, v[static_cast<rapidjson::SizeType>(i)], i);
+				if (dr.m_error)
+				{
+					dr.m_error.PrependIndex(i);
+					slice.index = i;
+					slice.error = dr.m_error;
+					break;
+				}
+			}
+		});
+
+		for (size_t s = 0; s < slices; s++)
+		{
+			if (m_slices[s].index != npos)
+			{
+				m_error = m_slices[s].error;
+				return m_slices[s].index;
+			}
+		}
+
+		return npos;
+	}
+
+	template<typename T>
+	static void CopyValue(T& t, const T& v)
+	{
+		t = v;
+	}
+
+	template<typename T, size_t N>
+	static void CopyValue(T(&t)[N], const T(&v)[N])
+	{
+		for (size_t i = 0; i < N; i++)
+			CopyValue(t[i], v[i]);
+	}
+
+	template<typename T>
+	static void MoveValue(T& t, T& v)
+	{
+		t = std::move(v);
+	}
+
+	template<typename T, size_t N>
+	static void MoveValue(T(&t)[N], T(&v)[N])
+	{
+		for (size_t i = 0; i < N; i++)
+			MoveValue(t[i], v[i]);
+	}
+
+	template<typename T>
+	static auto Reserve(T& t, size_t n, int) -> decltype(t.reserve(n), void())
+	{
+		t.reserve(t.size() + n);
+	}
+
+	template<typename T>
+	static void Reserve(T&, size_t, long)
+	{
+	}
+
 	template<typename T, typename BeginObject>
 	auto ReadObject(T&& t, rapidjson::Value& v, BeginObject) ->
-		std::enable_if_t<std::is_array<T>::value || is_std_array<T>::value>
+		std::enable_if_t<std::is_array<std::remove_reference_t<T>>::value || is_std_array<std::decay_t<T>>::value>
 	{
-		using U = typename std::decay<T>::type;
+		if (!ExpectArray(v))
+			return;
+
+		//the elements past the end of the array are ignored.
+		const size_t sz = (std::min)(static_cast<size_t>(v.Size()), sizeof(t) / sizeof(t[0]));
+		if (IsParallel(sz))
+			return ReadFixedParallel(t, v, sz);
 
-		size_t sz = v.Size();
 		for (rapidjson::SizeType i = 0; i < sz; i++)
 		{
-			typename U::value_type value;
-			ReadObject(value, v[i], std::true_type{});
-			t[i] = value;
+			ReadObject(t[i], v[i], std::true_type{});
+			if (m_error)
+				return m_error.PrependIndex(i);
 		}
 	}
 
-	template<typename T, typename value_type>
-	auto push(T& t, value_type& v, std::size_t index) ->
-		std::enable_if_t<is_singlevalue_container<T>::value&&!is_set<T>::value&&!is_multiset<T>::value&&!is_unordered_set<T>::value>
+	//the slices read copies of the elements, which are moved back up to the failed one: the array
+	//then ends like the sequential read, the elements after the failed one are untouched.
+	template<typename T>
+	void ReadFixedParallel(T& t, rapidjson::Value& v, size_t sz)
 	{
-		t.push_back(v);
-	}
+		using value_type = std::remove_reference_t<decltype(t[0])>;
+		std::unique_ptr<value_type[]> read(new value_type[sz]);
+		const size_t failed = ReadParallel(v, sz, [&t, &read](DeSerializer& dr, rapidjson::Value& e, size_t i)
+		{
+			CopyValue(read[i], t[i]);
+			dr.ReadObject(read[i], e, std::true_type{});
+		});
 
-	template<typename T, typename value_type>
-	auto push(T& t, value_type& v, std::size_t index) ->
-		std::enable_if_t<is_set<T>::value || is_multiset<T>::value || is_unordered_set<T>::value>
-	{
-		t.insert(v);
+		const size_t end = failed == npos ? sz : failed + 1;
+		for (size_t i = 0; i < end; i++)
+			MoveValue(t[i], read[i]);
 	}
 
 	template<typename T, typename value_type>
-	auto push(T& t, value_type& v, std::size_t index) ->
-		std::enable_if_t<is_std_array<T>::value || std::is_array<T>::value>
+	auto push(T& t, value_type&& v) ->
+		std::enable_if_t<is_singlevalue_container<T>::value&&!is_set<T>::value&&!is_multiset<T>::value&&!is_unordered_set<T>::value>
 	{
-		t[index] = v;
+		t.push_back(std::move(v));
 	}
 
+	//the json of a set is sorted, so the end is the insert position of every element.
 	template<typename T, typename value_type>
-	auto push(T& t, value_type& v, std::size_t index) ->
-		std::enable_if_t<is_container_adapter<T>::value || is_stack<T>::value>
+	auto push(T& t, value_type&& v) ->
+		std::enable_if_t<is_set<T>::value || is_multiset<T>::value || is_unordered_set<T>::value>
 	{
-		t.push(v);
+		t.emplace_hint(t.end(), std::move(v));
 	}
 
+
 	template<typename T, typename BeginObject>
 	auto ReadObject(T&& t, rapidjson::Value& v, BeginObject) -> std::enable_if_t<is_map_container<T>::value>
 	{
 		using U = typename std::decay<T>::type;
+		using key_type = typename U::key_type;
 
-		for (rapidjson::Value::ConstMemberIterator it = v.MemberBegin(); it != v.MemberEnd(); it++)
-		{
-			using key_type = typename U::key_type;
-			using val_type = typename U::value_type::second_type;
-			key_type key;
-			val_type value;
+		if (!ExpectObject(v))
+			return;
 
-			key = boost::lexical_cast<key_type>(it->name.GetString());
+		Reserve(t, v.MemberCount(), 0);
+		for (auto it = v.MemberBegin(); it != v.MemberEnd(); ++it)
+		{
+			key_type key{};
+			const char* error = detail::key_cast(it->name.GetString(), it->name.GetStringLength(), key);
+			if (error != nullptr)
+			{
+				Fail(ErrorCode::bad_key, error);
+				return PrependKey(it->name);
+			}
 
-			ReadObject(value, (rapidjson::Value&)it->value, std::true_type {});
+			//the value is read in place, a duplicate key keeps its first value.
+			const size_t size = t.size();
+			auto pos = t.emplace_hint(t.end(), std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple());
+			if (t.size() == size)
+				continue;
 
-			t.emplace(key, value);
+			ReadObject(pos->second, it->value, std::true_type{});
+			if (m_error)
+				return PrependKey(it->name);
 		}
 	}
 
@@ -299,10 +770,9 @@ private:
 		ReadObject(t, val, std::true_type{});
 	}
 
-	template<size_t N = 0, typename BeginObject, typename ... Args>
-	void ReadValue(variant<Args...>& v, rapidjson::Value& val, BeginObject obj)
+	template<size_t N = 0, typename T, typename BeginObject>
+	auto ReadValue(T& v, rapidjson::Value& val, BeginObject) -> std::enable_if_t<is_variant<T>::value>
 	{
-		//ReadObject(t, val, std::true_type{});
 		ReadObject(v, val, std::true_type{});
 	}
 
@@ -321,13 +791,22 @@ private:
 		using first_type = typename pair_t::first_type;
 		using second_type = typename pair_t::second_type;
 
-		//assert(val.MemberCount() == 1);
-		if(val.MemberCount()!=1)
-			throw std::invalid_argument("member count error");
+		if (!val.IsObject() || val.MemberCount() != 1)
+			return Fail(ErrorCode::member_count, "member count error");
 
 		auto itr = val.MemberBegin();
-		t.first = boost::lexical_cast<first_type>(itr->name.GetString());
+		first_type first{};
+		const char* error = detail::key_cast(itr->name.GetString(), itr->name.GetStringLength(), first);
+		if (error != nullptr)
+		{
+			Fail(ErrorCode::bad_key, error);
+			return PrependKey(itr->name);
+		}
+
+		t.first = std::move(first);
 		ReadObject(t.second, itr->value, bo);
+		if (m_error)
+			PrependKey(itr->name);
 	}
 
 	template<size_t N = 0, typename T>
@@ -345,82 +824,59 @@ private:
 	template<size_t N = 0, typename T>
 	auto ReadValue(T&& t, rapidjson::Value& val, std::false_type bo) -> std::enable_if_t<is_tuple<T>::value>
 	{
-		//assert(!val.IsArray());
-		if(val.IsArray())
-			throw std::invalid_argument("should not be array");
+		if (m_error)
+			return;
+
+		if (val.IsArray())
+			return Fail(ErrorCode::type_mismatch, "should not be array");
+
+		if (!val.IsObject())
+			return;
 
 		decltype(auto) tuple_elem = std::get<N>(t);
 		auto itr = val.FindMember(tuple_elem.first);
 		if(itr==val.MemberEnd())
 			return;
 
-		//assert(itr != val.MemberEnd());
 		ReadObject(tuple_elem, (rapidjson::Value&)(itr->value), bo);
+		if (m_error)
+			PrependKey(itr->name);
 	}
 
 	template<size_t N = 0, typename T>
 	auto ReadValue(T&& t, rapidjson::Value& val, std::true_type bo) -> std::enable_if_t<is_tuple<T>::value>
 	{
-		//assert(val.IsArray());
-		if (!val.IsArray())
-			throw std::invalid_argument("should be array");
-		ReadObject(std::get<N>(t), val[N], bo);
-	}
+		if (m_error)
+			return;
 
-// functions for variant
-private:
-	template <int Index, typename ... Args>
-	void LoadVariantImplFunc(rapidjson::Value& value, variant<Args...>& v)
-	{
-		using index_type = boost::mpl::int_<Index>;
-		using value_type = typename boost::mpl::at<typename variant<Args...>::types, index_type>::type;
-		
-		value_type temp;
-		ReadObject(temp, value, std::true_type{});
-		
-		v = temp;
-	}
+		if (!ExpectArray(val))
+			return;
 
-	template <int Begin, int End>
-	struct LoadVariantImpl
-	{
-		template <typename Variant>
-		void operator() (DeSerializer& dr, rapidjson::Value& value, size_t index, Variant& v)
-		{
-			if (Begin == index)
-			{
-				dr.LoadVariantImplFunc<Begin>(value, v);
-				return;
-			}
+		if (N >= val.Size())
+			return Fail(ErrorCode::member_count, "the array is too short");
 
-			LoadVariantImpl<Begin + 1, End>{}(dr, value, index, v);
-		}
-	};
+		ReadObject(std::get<N>(t), val[N], bo);
+		if (m_error)
+			m_error.PrependIndex(N);
+	}
 
-	template <int End>
-	struct LoadVariantImpl<End, End>
+private:
+	struct SliceError
 	{
-		template <typename Variant>
-		void operator() (DeSerializer& dr,rapidjson::Value& value, size_t index, Variant& v)
-		{
-			if (End == index)
-			{
-				dr.LoadVariantImplFunc<End>(value, v);
-				return;
-			}
-
-			throw std::invalid_argument{ "Wrong variant types." };
-		}
+		size_t index;
+		Error error;
 	};
 
-	template <typename ... Args>
-	void LoadVariant(rapidjson::Value& value, size_t index, variant<Args...>& v)
-	{
-		LoadVariantImpl<0, sizeof...(Args) - 1>{}(*this, value, index, v);
-	}
+	static const size_t npos = static_cast<size_t>(-1);
 
-private:
 	JsonUtil m_jsutil;
+	MappedFile m_file; //the file parsed in place, the document points into it.
+	Error m_error;
+	size_t m_threads = 1;
+	size_t m_parallel_min = parallel_min_elements;
+	std::unique_ptr<DeSerializer[]> m_workers;
+	std::unique_ptr<ThreadPool> m_pool;
+	std::vector<SliceError> m_slices;
 };
 } // namespace kapok
 
@@ -0,0 +1,104 @@
+#pragma once
+#include <memory>
+#include <cstdint>
+#include "rapidjson/document.h"
+#include "rapidjson/allocators.h"
+#include "Common.hpp"
+
+namespace kapok {
+// The document of the DeSerializer: its values and its parse stack both come from memory pools.
+using Document = rapidjson::GenericDocument<rapidjson::UTF8<>, rapidjson::MemoryPoolAllocator<>, rapidjson::MemoryPoolAllocator<>>;
+
+// Keeps the memory of the document between the messages. The values are allocated from an arena
+// and the parse stack from a stack buffer, each is the first block of a MemoryPoolAllocator. What
+// does not fit goes to chunks which Reset frees, a message which fits parses without malloc.
+class DocumentPool : NonCopyable
+{
+	using Pool = rapidjson::MemoryPoolAllocator<>;
+
+public:
+	static const size_t default_arena_size = 64 * 1024;
+	static const size_t default_chunk_size = 64 * 1024;
+	static const size_t default_stack_size = 4 * 1024;
+
+	Document& GetDocument()
+	{
+		return m_doc;
+	}
+
+	//releases the document and the chunks, the arena and the stack buffer stay for the next message.
+	void Reset()
+	{
+		if (!m_values)
+			Rebuild();
+
+		m_doc.SetNull();
+		m_values->Clear();
+		m_stack->Clear();
+	}
+
+	//the bytes held by the arena, the chunks and the stack buffer.
+	size_t GetReserved() const
+	{
+		return m_values ? m_values->Capacity() + m_stack->Capacity() : 0;
+	}
+
+	//an arena_size of 0 allocates every value from chunks of chunk_size bytes.
+	void SetArena(size_t arena_size, size_t chunk_size = default_chunk_size)
+	{
+		m_arena_size = arena_size;
+		m_chunk_size = chunk_size;
+		Rebuild();
+	}
+
+	//the parse stack uses the caller's buffer, it must outlive the pool. A null buffer restores
+	//the pool's own one.
+	void SetStackBuffer(void* buffer, size_t size)
+	{
+		m_stack_buffer = buffer;
+		m_stack_size = buffer != nullptr ? size : default_stack_size;
+		Rebuild();
+	}
+
+private:
+	static const size_t min_buffer_size = 64; //a pool buffer starts with a chunk header.
+
+	static void* Align(void* buffer, size_t& size)
+	{
+		const size_t skip = (8 - reinterpret_cast<uintptr_t>(buffer) % 8) % 8;
+		size = size > skip ? size - skip : 0;
+		return static_cast<char*>(buffer) + skip;
+	}
+
+	//the document is rebuilt on the new pools and swapped in, the old ones are released in order.
+	void Rebuild()
+	{
+		std::unique_ptr<char[]> arena(m_arena_size >= min_buffer_size ? new char[m_arena_size] : nullptr);
+		std::unique_ptr<char[]> own_stack(m_stack_buffer == nullptr ? new char[m_stack_size] : nullptr);
+		size_t stack_size = m_stack_size;
+		void* stack_buffer = Align(m_stack_buffer != nullptr ? m_stack_buffer : own_stack.get(), stack_size);
+
+		std::unique_ptr<Pool> values(arena ? new Pool(arena.get(), m_arena_size, m_chunk_size) : new Pool(m_chunk_size));
+		std::unique_ptr<Pool> stack(stack_size >= min_buffer_size ? new Pool(stack_buffer, stack_size, m_chunk_size) : new Pool(m_chunk_size));
+		const size_t stack_capacity = stack_size >= min_buffer_size ? (stack_size - min_buffer_size) & ~size_t(7) : 1024;
+		Document doc(values.get(), stack_capacity, stack.get());
+
+		m_doc.Swap(doc);
+		m_values.swap(values);
+		m_stack.swap(stack);
+		m_arena.swap(arena);
+		m_own_stack.swap(own_stack);
+	}
+
+	size_t m_arena_size = default_arena_size;
+	size_t m_chunk_size = default_chunk_size;
+	void* m_stack_buffer = nullptr;
+	size_t m_stack_size = default_stack_size;
+
+	std::unique_ptr<char[]> m_arena;
+	std::unique_ptr<char[]> m_own_stack;
+	std::unique_ptr<Pool> m_values;
+	std::unique_ptr<Pool> m_stack;
+	Document m_doc;
+};
+} // namespace kapok
@@ -0,0 +1,380 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include "rapidjson/internal/dtoa.h"
+#include "rapidjson/internal/itoa.h"
+#include "NumberParse.hpp"
+
+namespace kapok {
+namespace detail
+{
+	// Grisu3 of double-conversion on the cached powers of rapidjson. It generates the shortest and
+	// closest digits, or returns false in the rare cases (about 0.5%) where the 64 bits DiyFp is not
+	// precise enough to decide, then the caller falls back to an exact method.
+	inline bool round_weed(char* buffer, int length, uint64_t distance_too_high_w, uint64_t unsafe_interval,
+		uint64_t rest, uint64_t ten_kappa, uint64_t unit)
+	{
+		const uint64_t small_distance = distance_too_high_w - unit;
+		const uint64_t big_distance = distance_too_high_w + unit;
+		while (rest < small_distance && unsafe_interval - rest >= ten_kappa &&
+			(rest + ten_kappa < small_distance || small_distance - rest >= rest + ten_kappa - small_distance))
+		{
+			buffer[length - 1]--;
+			rest += ten_kappa;
+		}
+
+		if (rest < big_distance && unsafe_interval - rest >= ten_kappa &&
+			(rest + ten_kappa < big_distance || big_distance - rest > rest + ten_kappa - big_distance))
+			return false;
+
+		return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+	}
+
+	inline bool grisu3_digits(const rapidjson::internal::DiyFp& low, const rapidjson::internal::DiyFp& w,
+		const rapidjson::internal::DiyFp& high, char* buffer, int* length, int* kappa)
+	{
+		using rapidjson::internal::DiyFp;
+		static const uint32_t pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+		uint64_t unit = 1;
+		const DiyFp too_low(low.f - unit, low.e);
+		const DiyFp too_high(high.f + unit, high.e);
+		uint64_t unsafe_interval = too_high.f - too_low.f;
+		const DiyFp one(uint64_t(1) << -w.e, w.e);
+		uint32_t integrals = static_cast<uint32_t>(too_high.f >> -one.e);
+		uint64_t fractionals = too_high.f & (one.f - 1);
+
+		*kappa = integrals == 0 ? 0 : static_cast<int>(rapidjson::internal::CountDecimalDigit32(integrals));
+		*length = 0;
+		while (*kappa > 0)
+		{
+			const uint32_t divisor = pow10[*kappa - 1];
+			buffer[(*length)++] = static_cast<char>('0' + integrals / divisor);
+			integrals %= divisor;
+			(*kappa)--;
+			const uint64_t rest = (static_cast<uint64_t>(integrals) << -one.e) + fractionals;
+			if (rest < unsafe_interval)
+				return round_weed(buffer, *length, too_high.f - w.f, unsafe_interval, rest, static_cast<uint64_t>(divisor) << -one.e, unit);
+		}
+
+		for (;;)
+		{
+			fractionals *= 10;
+			unit *= 10;
+			unsafe_interval *= 10;
+			buffer[(*length)++] = static_cast<char>('0' + (fractionals >> -one.e));
+			fractionals &= one.f - 1;
+			(*kappa)--;
+			if (fractionals < unsafe_interval)
+				return round_weed(buffer, *length, (too_high.f - w.f) * unit, unsafe_interval, fractionals, one.f, unit);
+		}
+	}
+
+	inline bool grisu3(double value, char* buffer, int* length, int* K)
+	{
+		using rapidjson::internal::DiyFp;
+		uint64_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		const int biased = static_cast<int>((bits >> 52) & 0x7FF);
+		uint64_t f = bits & DiyFp::kDpSignificandMask;
+		int e = DiyFp::kDpDenormalExponent;
+		if (biased != 0)
+		{
+			f |= DiyFp::kDpHiddenBit;
+			e = biased - DiyFp::kDpExponentBias;
+		}
+
+		//the lower neighbour is closer at a power of two, except next to the subnormals.
+		DiyFp plus = DiyFp((f << 1) + 1, e - 1).Normalize();
+		DiyFp minus = (f == DiyFp::kDpHiddenBit && biased > 1) ? DiyFp((f << 2) - 1, e - 2) : DiyFp((f << 1) - 1, e - 1);
+		minus.f <<= minus.e - plus.e;
+		minus.e = plus.e;
+
+		const DiyFp c_mk = rapidjson::internal::GetCachedPower(plus.e, K);
+		int kappa;
+		bool ok = grisu3_digits(minus * c_mk, DiyFp(f, e).Normalize() * c_mk, plus * c_mk, buffer, length, &kappa);
+		*K += kappa;
+		return ok;
+	}
+
+	//compares a + b with c, rest is a scratch.
+	inline int compare_sum(const rapidjson::internal::BigInteger& a, const rapidjson::internal::BigInteger& b,
+		const rapidjson::internal::BigInteger& c, rapidjson::internal::BigInteger& rest)
+	{
+		if (a.IsZero())
+			return b.Compare(c);
+
+		if (b.Compare(c) >= 0)
+			return 1;
+
+		c.Difference(b, &rest);
+		return a.Compare(rest);
+	}
+
+	inline void multiply_pow10(rapidjson::internal::BigInteger& n, int exp)
+	{
+		n.MultiplyPow5(static_cast<unsigned>(exp));
+		shift_left(n, static_cast<size_t>(exp));
+	}
+
+	// The exact fallback of grisu3, the free format digits of Steele & White and Burger & Dybvig on
+	// big integers. The value is r / s, the middles to its neighbours are (r - m_minus) / s and
+	// (r + m_plus) / s, a middle reads back to the value when the significand is even.
+	inline void exact_shortest(double value, char* buffer, int* length, int* K)
+	{
+		using rapidjson::internal::BigInteger;
+		uint64_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		const int biased = static_cast<int>((bits >> 52) & 0x7FF);
+		const uint64_t hidden = uint64_t(1) << 52;
+		uint64_t f = bits & (hidden - 1);
+		int e = -1074;
+		if (biased != 0)
+		{
+			f |= hidden;
+			e = biased - 1075;
+		}
+
+		//r and s are scaled by 2, or by 4 when the lower neighbour is closer, for integer middles.
+		const bool even = (f & 1) == 0;
+		const bool closer = f == hidden && biased > 1;
+		const int scale = closer ? 2 : 1;
+		BigInteger r(f), s(1), m_minus(1);
+		if (e >= 0)
+		{
+			shift_left(r, static_cast<size_t>(e + scale));
+			shift_left(s, static_cast<size_t>(scale));
+			shift_left(m_minus, static_cast<size_t>(e));
+		}
+		else
+		{
+			shift_left(r, static_cast<size_t>(scale));
+			shift_left(s, static_cast<size_t>(scale - e));
+		}
+
+		BigInteger m_plus(m_minus);
+		if (closer)
+			shift_left(m_plus, 1);
+
+		//k from the bit length never exceeds the digit count of the upper middle, and misses it by one at most.
+		int bit_length = 0;
+		for (uint64_t n = f; n != 0; n >>= 1)
+			bit_length++;
+
+		int k = static_cast<int>(std::ceil((e + bit_length - 1) * 0.30102999566398114 - 1e-10));
+		if (k >= 0)
+		{
+			multiply_pow10(s, k);
+		}
+		else
+		{
+			multiply_pow10(r, -k);
+			multiply_pow10(m_minus, -k);
+			multiply_pow10(m_plus, -k);
+		}
+
+		BigInteger scratch(0);
+		if (compare_sum(r, m_plus, s, scratch) >= (even ? 0 : 1))
+		{
+			s *= uint64_t(10);
+			k++;
+		}
+
+		//with the top word of s in [2^59, 2^60) and r < 10 s, the top words give each digit or one less.
+		int top_bits = 0;
+		for (uint64_t n = s.GetDigit(s.GetCount() - 1); n != 0; n >>= 1)
+			top_bits++;
+
+		if (top_bits != 60)
+		{
+			const size_t normalize = static_cast<size_t>(top_bits < 60 ? 60 - top_bits : 124 - top_bits);
+			shift_left(r, normalize);
+			shift_left(s, normalize);
+			shift_left(m_minus, normalize);
+			shift_left(m_plus, normalize);
+		}
+
+		const size_t words = s.GetCount();
+		const uint64_t top = s.GetDigit(words - 1) + 1;
+
+		//the remainder goes back and forth between r and scratch, Difference can't write into its operand.
+		BigInteger* rest = &r;
+		BigInteger* spare = &scratch;
+		BigInteger product(0);
+		*length = 0;
+		for (;;)
+		{
+			*rest *= uint64_t(10);
+			m_minus *= uint64_t(10);
+			m_plus *= uint64_t(10);
+
+			int digit = rest->GetCount() == words ? static_cast<int>(rest->GetDigit(words - 1) / top) : 0;
+			if (digit != 0)
+			{
+				product = s;
+				product *= static_cast<uint64_t>(digit);
+				if (rest->Compare(product) == 0)
+				{
+					*rest = 0;
+				}
+				else
+				{
+					rest->Difference(product, spare);
+					std::swap(rest, spare);
+				}
+			}
+
+			for (int cmp; (cmp = rest->Compare(s)) >= 0; digit++)
+			{
+				if (cmp == 0)
+				{
+					*rest = 0;
+				}
+				else
+				{
+					rest->Difference(s, spare);
+					std::swap(rest, spare);
+				}
+			}
+
+			const int low = rest->Compare(m_minus);
+			const int high = compare_sum(*rest, m_plus, s, *spare);
+			const bool low_ok = even ? low <= 0 : low < 0;
+			const bool high_ok = even ? high >= 0 : high > 0;
+			if (!low_ok && !high_ok)
+			{
+				buffer[(*length)++] = static_cast<char>('0' + digit);
+				continue;
+			}
+
+			//both last digits read back: the closest, an exact half goes to the even digit.
+			if (low_ok && high_ok)
+			{
+				shift_left(*rest, 1);
+				const int cmp = rest->Compare(s);
+				if (cmp > 0 || (cmp == 0 && (digit & 1) != 0))
+					digit++;
+			}
+			else if (high_ok)
+			{
+				digit++;
+			}
+
+			buffer[(*length)++] = static_cast<char>('0' + digit);
+			break;
+		}
+
+		*K = k - *length;
+	}
+
+	inline char* write_zero(double value, char* buffer)
+	{
+		if (std::signbit(value))
+			*buffer++ = '-';
+
+		std::memcpy(buffer, "0.0", 3);
+		return buffer + 3;
+	}
+}
+
+// The engines formatting the doubles of the Serializer, a engine writes at most 32 bytes.
+// shortest: the shortest digits which read back to the same double, the default.
+struct shortest
+{
+	static char* Write(double value, char* buffer)
+	{
+		if (value == 0)
+			return detail::write_zero(value, buffer);
+
+		if (value < 0)
+		{
+			*buffer++ = '-';
+			value = -value;
+		}
+
+		int length, K;
+		if (!detail::grisu3(value, buffer, &length, &K))
+			detail::exact_shortest(value, buffer, &length, &K);
+
+		return rapidjson::internal::Prettify(buffer, length, K, 324);
+	}
+};
+
+// grisu2: rapidjson::internal::dtoa, which may write a digit more than shortest.
+struct grisu2
+{
+	static char* Write(double value, char* buffer)
+	{
+		return rapidjson::internal::dtoa(value, buffer);
+	}
+};
+
+// precision<N>: N digits after the point as %.Nf, without the trailing zeros. The digits are rounded
+// from the exact value, an exact half goes to the even digit. The values too big for N digits in a
+// double fall back to shortest.
+template<int N>
+struct precision
+{
+	static_assert(N >= 1 && N <= 15, "precision must be in [1, 15]");
+
+	static char* Write(double value, char* buffer)
+	{
+		const double scale = Pow10();
+		const double scaled = std::fabs(value) * scale;
+		if (!(scaled < 9007199254740992.0))
+			return shortest::Write(value, buffer);
+
+		if (std::signbit(value))
+			*buffer++ = '-';
+
+		const uint64_t n = Round(std::fabs(value), scale, scaled);
+		const uint64_t divisor = static_cast<uint64_t>(scale);
+		buffer = rapidjson::internal::u64toa(n / divisor, buffer);
+		*buffer++ = '.';
+
+		uint64_t fraction = n % divisor;
+		char* end = buffer + N;
+		for (char* p = end; p != buffer;)
+		{
+			*--p = static_cast<char>('0' + fraction % 10);
+			fraction /= 10;
+		}
+
+		while (end - buffer > 1 && end[-1] == '0')
+			--end;
+
+		return end;
+	}
+
+private:
+	//scaled is value * scale rounded, fma gives the exact rest of the product when scaled looks
+	//like a half (or has no fraction bits left) and the rounding of the product decides.
+	static uint64_t Round(double value, double scale, double scaled)
+	{
+		const double whole = std::floor(scaled);
+		const double fraction = scaled - whole;
+		uint64_t n = static_cast<uint64_t>(whole);
+		if (fraction != 0.5 && scaled < 4503599627370496.0)
+			return n + (fraction > 0.5 ? 1 : 0);
+
+		const double half = fraction - 0.5;
+		const double rest = -std::fma(value, scale, -scaled);
+		if (half > rest || (half == rest && (n & 1) != 0))
+			n++;
+		else if (fraction == 0 && rest == 0.5 && (n & 1) != 0)
+			n--;
+
+		return n;
+	}
+
+	static double Pow10()
+	{
+		double scale = 1;
+		for (int i = 0; i < N; i++)
+			scale *= 10;
+
+		return scale;
+	}
+};
+} // namespace kapok
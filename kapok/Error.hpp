@@ -0,0 +1,140 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+
+//KAPOK_NO_EXCEPTIONS removes every throw, it is defined by itself when the exceptions are disabled
+//(-fno-exceptions). The throwing functions then only record the error, GetError tells what failed.
+#if !defined(KAPOK_NO_EXCEPTIONS) && !(defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND))
+#define KAPOK_NO_EXCEPTIONS
+#endif
+
+#ifdef KAPOK_NO_EXCEPTIONS
+#define KAPOK_THROW(e) ((void)0)
+#else
+#define KAPOK_THROW(e) throw e
+#endif
+
+namespace kapok {
+enum class ErrorCode
+{
+	ok,
+	parse_error,	//the json text is not valid json.
+	key_not_found,	//the root key is not in the json.
+	type_mismatch,	//an array for an object or the reverse.
+	member_count,	//a pair or a variant which is not an object with one member, a short tuple array.
+	variant_index,	//the index of a variant is out of range.
+	bad_key,		//a map key which does not convert to the key type.
+	write_failed,	//the sink of the serializer failed.
+	file_error		//the json file could not be opened, read or mapped.
+};
+
+// The first error of a Try function, kept in the (de)serializer without allocating. The message is
+// a static string, the path is a json pointer such as /person/friends/2/name, the outer segments
+// of a path longer than the buffer are replaced by "...".
+class Error
+{
+public:
+	static const size_t npos = static_cast<size_t>(-1);
+
+	ErrorCode code = ErrorCode::ok;
+	const char* message = "";
+	size_t offset = npos; //the byte offset in the json text, npos when the error is found after parsing.
+
+	explicit operator bool() const
+	{
+		return code != ErrorCode::ok;
+	}
+
+	const char* GetPath() const
+	{
+		return m_path + m_begin;
+	}
+
+	void Clear()
+	{
+		code = ErrorCode::ok;
+		message = "";
+		offset = npos;
+		m_begin = path_size - 1;
+		m_path[m_begin] = '\0';
+	}
+
+	void Set(ErrorCode c, const char* msg, size_t off = npos)
+	{
+		if (code != ErrorCode::ok)
+			return;
+
+		code = c;
+		message = msg;
+		offset = off;
+	}
+
+	//the segments are prepended while returning from the failed value, the '~' and '/' of a key are escaped.
+	void PrependKey(const char* key, size_t length)
+	{
+		size_t escaped = length + 1;
+		for (size_t i = 0; i < length; i++)
+			escaped += key[i] == '~' || key[i] == '/';
+
+		if (!Reserve(escaped))
+			return;
+
+		char* p = m_path + m_begin + escaped;
+		for (size_t i = length; i-- > 0;)
+		{
+			if (key[i] == '~' || key[i] == '/')
+			{
+				*--p = key[i] == '~' ? '0' : '1';
+				*--p = '~';
+			}
+			else
+			{
+				*--p = key[i];
+			}
+		}
+		*--p = '/';
+	}
+
+	void PrependIndex(size_t index)
+	{
+		char digits[24];
+		char* p = digits + sizeof(digits);
+		do
+		{
+			*--p = static_cast<char>('0' + index % 10);
+			index /= 10;
+		} while (index != 0);
+
+		const size_t length = digits + sizeof(digits) - p;
+		if (!Reserve(length + 1))
+			return;
+
+		m_path[m_begin] = '/';
+		std::memcpy(m_path + m_begin + 1, p, length);
+	}
+
+private:
+	static const size_t path_size = 128;
+
+	//moves the start back by length bytes, or writes "..." once there is no room left. A path
+	//starts with '/' until it is cut.
+	bool Reserve(size_t length)
+	{
+		if (m_path[m_begin] == '.')
+			return false;
+
+		if (length + 3 > m_begin)
+		{
+			m_begin -= 3;
+			std::memcpy(m_path + m_begin, "...", 3);
+			return false;
+		}
+
+		m_begin -= length;
+		return true;
+	}
+
+	char m_path[path_size] = {};
+	size_t m_begin = path_size - 1;
+};
+} // namespace kapok
@@ -0,0 +1,130 @@
+#pragma once
+#include <cstddef>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define KAPOK_ESCAPE_SSE2
+#define KAPOK_ESCAPE_AVX2
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define KAPOK_ESCAPE_SSE2
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#define KAPOK_ESCAPE_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace kapok {
+namespace detail
+{
+	// A json string needs an escape for the control characters, '"' and '\\', the other bytes
+	// including the utf-8 ones are copied as they are.
+	inline bool need_escape(unsigned char c)
+	{
+		return c < 0x20 || c == '"' || c == '\\';
+	}
+
+	inline const char* find_escape_scalar(const char* p, const char* end)
+	{
+		while (p != end && !need_escape(static_cast<unsigned char>(*p)))
+			++p;
+
+		return p;
+	}
+
+	inline unsigned lowest_bit(unsigned mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+#ifdef KAPOK_ESCAPE_SSE2
+	inline const char* find_escape_sse2(const char* p, const char* end)
+	{
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i backslash = _mm_set1_epi8('\\');
+		const __m128i control = _mm_set1_epi8(0x1F);
+		for (; end - p >= 16; p += 16)
+		{
+			__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			//max(s, 0x1F) == 0x1F is the unsigned s <= 0x1F, the utf-8 bytes are not taken as negative.
+			__m128i x = _mm_or_si128(_mm_cmpeq_epi8(s, quote), _mm_cmpeq_epi8(s, backslash));
+			x = _mm_or_si128(x, _mm_cmpeq_epi8(_mm_max_epu8(s, control), control));
+			unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(x));
+			if (mask != 0)
+				return p + lowest_bit(mask);
+		}
+
+		return find_escape_scalar(p, end);
+	}
+#endif
+
+#ifdef KAPOK_ESCAPE_AVX2
+#if defined(__GNUC__)
+	__attribute__((target("avx2")))
+#endif
+	inline const char* find_escape_avx2(const char* p, const char* end)
+	{
+		const __m256i quote = _mm256_set1_epi8('"');
+		const __m256i backslash = _mm256_set1_epi8('\\');
+		const __m256i control = _mm256_set1_epi8(0x1F);
+		for (; end - p >= 32; p += 32)
+		{
+			__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			__m256i x = _mm256_or_si256(_mm256_cmpeq_epi8(s, quote), _mm256_cmpeq_epi8(s, backslash));
+			x = _mm256_or_si256(x, _mm256_cmpeq_epi8(_mm256_max_epu8(s, control), control));
+			unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(x));
+			if (mask != 0)
+				return p + lowest_bit(mask);
+		}
+
+		return find_escape_sse2(p, end);
+	}
+#endif
+
+	using find_escape_func = const char*(*)(const char*, const char*);
+
+	inline find_escape_func select_find_escape()
+	{
+#if defined(KAPOK_ESCAPE_AVX2) && defined(__GNUC__)
+		if (__builtin_cpu_supports("avx2"))
+			return find_escape_avx2;
+#elif defined(KAPOK_ESCAPE_AVX2)
+		return find_escape_avx2;
+#endif
+#ifdef KAPOK_ESCAPE_SSE2
+		return find_escape_sse2;
+#else
+		return find_escape_scalar;
+#endif
+	}
+
+	// Returns the first byte of [p, end) which needs an escape, or end. The instruction set is
+	// checked once at runtime, define KAPOK_NO_SIMD_ESCAPE to always use the scalar loop.
+	inline const char* find_escape(const char* p, const char* end)
+	{
+#ifdef KAPOK_NO_SIMD_ESCAPE
+		return find_escape_scalar(p, end);
+#else
+		//the short strings such as keys and enum names, and the short runs between the escapes,
+		//are not worth the indirect call.
+		const char* head = end - p < 16 ? end : p + 8;
+		p = find_escape_scalar(p, head);
+		if (p != head || p == end)
+			return p;
+
+		static const find_escape_func func = select_find_escape();
+		return func(p, end);
+#endif
+	}
+}
+} // namespace kapok
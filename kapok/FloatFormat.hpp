@@ -0,0 +1,123 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include "rapidjson/internal/dtoa.h"
+
+namespace kapok {
+namespace detail
+{
+	//the digits of b * 2^p when they are exact and fit in 64 bits, returns 0 otherwise.
+	inline int exact_boundary_digits(uint64_t b, int p, char* buffer, int* K)
+	{
+		uint64_t n = b;
+		int k = 0;
+		if (p >= 0)
+		{
+			if (p > 64 - 26)
+				return 0;
+
+			n <<= p;
+		}
+		else
+		{
+			if (p < -16)
+				return 0;
+
+			for (int i = p; i < 0; i++)
+				n *= 5;
+			k = p;
+		}
+
+		while (n % 10 == 0)
+		{
+			n /= 10;
+			k++;
+		}
+
+		char digits[20];
+		int length = 0;
+		for (; n != 0; n /= 10)
+			digits[length++] = static_cast<char>('0' + n % 10);
+
+		for (int i = 0; i < length; i++)
+			buffer[i] = digits[length - 1 - i];
+
+		*K = k;
+		return length;
+	}
+
+	// Grisu of rapidjson with the rounding boundaries of the float instead of the widened double,
+	// 0.1f is written as 0.1 and not 0.10000000149011612. The 64 bits DiyFp leaves 40 bits of margin
+	// over the 24 bits significand, so the digits are the shortest inside the open rounding interval.
+	// A float with an even significand also owns its boundaries (round half to even), a boundary
+	// which has fewer digits than the Grisu output is found exactly by exact_boundary_digits.
+	inline void shortest_float(float value, char* buffer, int* length, int* K)
+	{
+		using rapidjson::internal::DiyFp;
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		const uint32_t biased = (bits >> 23) & 0xFF;
+		uint64_t f = bits & 0x7FFFFF;
+		int e = 1 - 150;
+		if (biased != 0)
+		{
+			f |= 0x800000;
+			e = static_cast<int>(biased) - 150;
+		}
+
+		//the lower neighbour is closer at a power of two, except next to the subnormals.
+		const bool closer_lower = f == 0x800000 && biased > 1;
+		DiyFp plus = DiyFp((f << 1) + 1, e - 1).Normalize();
+		DiyFp minus = closer_lower ? DiyFp((f << 2) - 1, e - 2) : DiyFp((f << 1) - 1, e - 1);
+		minus.f <<= minus.e - plus.e;
+		minus.e = plus.e;
+
+		const DiyFp c_mk = rapidjson::internal::GetCachedPower(plus.e, K);
+		const DiyFp W = DiyFp(f, e).Normalize() * c_mk;
+		DiyFp Wp = plus * c_mk;
+		DiyFp Wm = minus * c_mk;
+		Wm.f++;
+		Wp.f--;
+		rapidjson::internal::DigitGen(W, Wp, Wp.f - Wm.f, buffer, length, K);
+
+		if ((f & 1) != 0 || *length == 1)
+			return;
+
+		char digits[20];
+		int k;
+		int n = exact_boundary_digits((f << 1) + 1, e - 1, digits, &k);
+		if (n == 0 || n >= *length)
+			n = closer_lower ? exact_boundary_digits((f << 2) - 1, e - 2, digits, &k) : exact_boundary_digits((f << 1) - 1, e - 1, digits, &k);
+
+		if (n != 0 && n < *length)
+		{
+			std::memcpy(buffer, digits, n);
+			*length = n;
+			*K = k;
+		}
+	}
+
+	//same layout as rapidjson::internal::dtoa, the buffer needs 25 bytes.
+	inline char* ftoa(float value, char* buffer)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		if (bits >> 31)
+		{
+			*buffer++ = '-';
+			bits &= 0x7FFFFFFF;
+			std::memcpy(&value, &bits, sizeof(bits));
+		}
+
+		if (bits == 0)
+		{
+			std::memcpy(buffer, "0.0", 3);
+			return buffer + 3;
+		}
+
+		int length, K;
+		shortest_float(value, buffer, &length, &K);
+		return rapidjson::internal::Prettify(buffer, length, K, 324);
+	}
+}
+} // namespace kapok
@@ -0,0 +1,209 @@
+#pragma once
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include "Common.hpp"
+
+namespace kapok {
+// Append-only output buffer of the serializer. The bytes live in a container whose size is
+// used as the capacity, m_size is the length of the json text, the capacity grows geometrically.
+// The container is the own std::string of the buffer, or one of the caller attached by Attach.
+// With a sink the buffer is flushed to it instead of growing, so the memory stays bounded.
+// The own std::string keeps the capacity of the largest json text, unless a trim policy is set.
+class JsonBuffer : NonCopyable
+{
+public:
+	using Sink = std::function<void(const char*, size_t)>;
+
+	explicit JsonBuffer(size_t capacity = 256)
+	{
+		Resize(capacity);
+	}
+
+	void Clear()
+	{
+		if (m_capacity > m_trim_threshold && m_target == &m_str && !m_sink)
+			Trim(m_trim_size);
+
+		m_size = 0;
+	}
+
+	//a buffer which grew over threshold bytes is shrunk to size bytes by the next Clear.
+	void SetTrimPolicy(size_t threshold, size_t size)
+	{
+		m_trim_threshold = threshold;
+		m_trim_size = size;
+	}
+
+	//drops the json text and shrinks the own buffer to capacity bytes.
+	void Trim(size_t capacity)
+	{
+		if (m_target != &m_str)
+			return;
+
+		std::string().swap(m_str);
+		m_size = 0;
+		Resize(capacity);
+	}
+
+	//the bytes allocated by the own buffer, an attached container belongs to the caller.
+	size_t GetReserved() const
+	{
+		return m_str.capacity();
+	}
+
+	void Put(char c)
+	{
+		if (m_size == m_capacity)
+			Grow(1);
+
+		m_data[m_size++] = c;
+	}
+
+	void Write(const char* str, size_t length)
+	{
+		//a big block goes to the sink directly instead of through the buffer.
+		if (m_capacity - m_size < length && m_sink)
+		{
+			Flush();
+			if (length >= m_capacity)
+			{
+				m_sink(str, length);
+				return;
+			}
+		}
+
+		char* p = Reserve(length);
+		std::memcpy(p, str, length);
+		m_size += length;
+	}
+
+	//returns the write position with at least length bytes room, Commit the bytes written there.
+	char* Reserve(size_t length)
+	{
+		if (m_capacity - m_size < length)
+			Grow(length);
+
+		return m_data + m_size;
+	}
+
+	void Commit(char* end)
+	{
+		m_size = end - m_data;
+	}
+
+	const char* GetString()
+	{
+		*Reserve(1) = '\0';
+		return m_data;
+	}
+
+	const char* GetData() const
+	{
+		return m_data;
+	}
+
+	size_t GetSize() const
+	{
+		return m_size;
+	}
+
+	//moves the json text out, the buffer starts again with an empty string.
+	std::string Release()
+	{
+		m_str.resize(m_size);
+		std::string str = std::move(m_str);
+		m_str.clear();
+		m_size = 0;
+		Resize(0);
+		return str;
+	}
+
+	//the json text is appended to the container until Detach, which cuts it to the json length.
+	//Container is std::string, std::vector<char> or any type with size, resize and operator[].
+	template<typename Container>
+	void Attach(Container& container)
+	{
+		m_target = &container;
+		m_resize = &ResizeContainer<Container>;
+		m_size = container.size();
+		m_capacity = 0;
+		Resize(m_size);
+	}
+
+	void Detach()
+	{
+		if (m_target != &m_str)
+		{
+			Resize(m_size);
+			m_size = 0;
+		}
+
+		m_target = &m_str;
+		m_resize = &ResizeContainer<std::string>;
+		m_capacity = 0;
+		Resize(m_str.size());
+	}
+
+	//the buffer is flushed to the sink when it is full, the capacity is at least capacity bytes.
+	void SetSink(Sink sink, size_t capacity)
+	{
+		m_sink = std::move(sink);
+		m_size = 0;
+		if (m_sink && m_capacity < capacity)
+			Resize(capacity);
+	}
+
+	bool HasSink() const
+	{
+		return static_cast<bool>(m_sink);
+	}
+
+	void Flush()
+	{
+		if (m_sink && m_size != 0)
+			m_sink(m_data, m_size);
+
+		m_size = 0;
+	}
+
+private:
+	template<typename Container>
+	static char* ResizeContainer(void* target, size_t size)
+	{
+		auto& container = *static_cast<Container*>(target);
+		container.resize(size);
+		return size == 0 ? nullptr : &container[0];
+	}
+
+	void Resize(size_t capacity)
+	{
+		m_data = m_resize(m_target, capacity);
+		m_capacity = capacity;
+	}
+
+	void Grow(size_t length)
+	{
+		if (m_sink)
+		{
+			Flush();
+			if (m_capacity >= length)
+				return;
+		}
+
+		Resize((std::max)(m_capacity * 2, m_size + length));
+	}
+
+private:
+	std::string m_str;
+	void* m_target = &m_str;
+	char* (*m_resize)(void*, size_t) = &ResizeContainer<std::string>;
+	char* m_data = nullptr;
+	size_t m_capacity = 0;
+	size_t m_size = 0;
+	Sink m_sink;
+	size_t m_trim_threshold = static_cast<size_t>(-1);
+	size_t m_trim_size = 0;
+};
+} // namespace kapok
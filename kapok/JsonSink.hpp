@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdio>
+#include <cerrno>
+#include <ostream>
+#ifdef _MSC_VER
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace kapok {
+// The destinations of the streaming Serialize, the serializer flushes its buffer into them
+// each time it is full, so the json text is never held in memory as a whole. A failed write
+// sets *error and the following writes are dropped, the serializer reports it at the end.
+struct FdSink
+{
+	int fd;
+	const char** error;
+
+	void operator()(const char* data, size_t length) const
+	{
+		while (length != 0 && *error == nullptr)
+		{
+#ifdef _MSC_VER
+			auto n = ::_write(fd, data, static_cast<unsigned>(length));
+#else
+			auto n = ::write(fd, data, length);
+#endif
+			if (n < 0)
+			{
+				if (errno == EINTR)
+					continue;
+
+				*error = "write json to fd failed";
+				return;
+			}
+
+			data += n;
+			length -= static_cast<size_t>(n);
+		}
+	}
+};
+
+struct OStreamSink
+{
+	std::ostream* os;
+	const char** error;
+
+	void operator()(const char* data, size_t length) const
+	{
+		if (*error == nullptr && !os->write(data, static_cast<std::streamsize>(length)))
+			*error = "write json to ostream failed";
+	}
+};
+
+struct FileSink
+{
+	FILE* fp;
+	const char** error;
+
+	void operator()(const char* data, size_t length) const
+	{
+		if (*error == nullptr && std::fwrite(data, 1, length, fp) != length)
+			*error = "write json to FILE failed";
+	}
+};
+} // namespace kapok
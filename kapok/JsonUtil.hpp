@@ -1,72 +1,264 @@
 #pragma once
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <cstdint>
-#include "rapidjson/writer.h"
-#include "rapidjson/stringbuffer.h"
 #include "rapidjson/document.h"
+#include "rapidjson/memorystream.h"
+#include "rapidjson/internal/itoa.h"
+#include "rapidjson/internal/dtoa.h"
+#include "rapidjson/internal/ieee754.h"
 
 #include "traits.hpp"
+#include "Error.hpp"
 #include "Common.hpp"
+#include "JsonBuffer.hpp"
+#include "EscapeScan.hpp"
+#include "FloatFormat.hpp"
+#include "DoubleFormat.hpp"
+#include "NumberParse.hpp"
+#include "DocumentPool.hpp"
+
+namespace kapok {
+namespace detail
+{
+	// rapidjson::InsituStringStream over a buffer of a known length, which needs no '\0'.
+	class InsituBufferStream
+	{
+	public:
+		typedef char Ch;
+
+		InsituBufferStream(char* buf, size_t length) : m_src(buf), m_dst(nullptr), m_head(buf), m_end(buf + length)
+		{
+		}
+
+		Ch Peek() const { return m_src < m_end ? *m_src : '\0'; }
+		Ch Take() { return *m_src++; } //the reader only takes a character it has peeked.
+		size_t Tell() const { return static_cast<size_t>(m_src - m_head); }
+
+		Ch* PutBegin() { return m_dst = m_src; }
+		void Put(Ch c) { *m_dst++ = c; }
+		void Flush() {}
+		size_t PutEnd(Ch* begin) { return static_cast<size_t>(m_dst - begin); }
+		Ch* Push(size_t count) { Ch* begin = m_dst; m_dst += count; return begin; }
+		void Pop(size_t count) { m_dst -= count; }
+
+	private:
+		Ch* m_src;
+		Ch* m_dst;
+		Ch* m_head;
+		Ch* m_end;
+	};
+
+	// The copy of a read-only text which is parsed in place, kept between the messages. Once a
+	// message grew it over the trim threshold, the next one shrinks it back to the trim size first.
+	class TextCopy
+	{
+	public:
+		char* Assign(const char* text, size_t length)
+		{
+			if (m_text.capacity() > m_trim_threshold)
+				Trim();
+
+			m_text.assign(text, text + length);
+			return m_text.data();
+		}
+
+		void SetTrimPolicy(size_t threshold, size_t size)
+		{
+			m_trim_threshold = threshold;
+			m_trim_size = size;
+		}
+
+		void Trim()
+		{
+			std::vector<char>().swap(m_text);
+			m_text.reserve(m_trim_size);
+		}
+
+		size_t GetReserved() const
+		{
+			return m_text.capacity();
+		}
+
+	private:
+		std::vector<char> m_text;
+		size_t m_trim_threshold = static_cast<size_t>(-1);
+		size_t m_trim_size = 0;
+	};
+}
+} // namespace kapok
+
+RAPIDJSON_NAMESPACE_BEGIN
+template <>
+struct StreamTraits<kapok::detail::InsituBufferStream>
+{
+	enum { copyOptimization = 1 };
+};
+RAPIDJSON_NAMESPACE_END
 
 namespace kapok {
 class JsonUtil : NonCopyable
 {
-	typedef rapidjson::Writer<rapidjson::StringBuffer> JsonWriter;
 public:
 
-	JsonUtil() : m_writer(m_buf)
+	JsonUtil()
 	{
 	}
 
 	template<typename T>
 	void WriteJson(const char* key, T&& value)
 	{
-		m_writer.String(key);
+		WriteKey(key, std::strlen(key));
 		WriteValue(std::forward<T>(value));
 	}
 
 	template<typename T>
 	void WriteJson(const std::string& key, T&& value)
 	{
-		m_writer.String(key.c_str());
+		WriteKey(key.c_str(), key.length());
 		WriteValue(std::forward<T>(value));
 	}
 
 	void Reset()
 	{
-		m_writer.Reset(m_buf);
 		m_buf.Clear();
 	}
 
+	//the json buffer and the copy of the parsed text are shrunk to size bytes before the next
+	//message once they grew over threshold bytes.
+	void SetTrimPolicy(size_t threshold, size_t size)
+	{
+		m_buf.SetTrimPolicy(threshold, size);
+		m_text.SetTrimPolicy(threshold, size);
+		m_trim_size = size;
+	}
+
+	//drops the json text and shrinks the json buffer now.
+	void TrimJson()
+	{
+		m_buf.Trim(m_trim_size);
+	}
+
+	//drops the document and shrinks the copy of the parsed text now.
+	void TrimDocument()
+	{
+		m_text.Trim();
+		m_pool.Reset();
+	}
+
+	//the bytes kept between the messages: the json buffer, the copy of the parsed text and the document pool.
+	size_t GetReserved() const
+	{
+		return m_buf.GetReserved() + m_text.GetReserved() + m_pool.GetReserved();
+	}
+
+	//the engine formatting the doubles, such as &shortest::Write or &precision<6>::Write.
+	using DoubleFormat = char* (*)(double value, char* buffer);
+
+	void SetDoubleFormat(DoubleFormat format)
+	{
+		m_double_format = format;
+	}
+
+	DoubleFormat GetDoubleFormat() const
+	{
+		return m_double_format;
+	}
+
+	//the json text is written to the sink each time capacity bytes are buffered.
+	void SetSink(JsonBuffer::Sink sink, size_t capacity)
+	{
+		m_buf.SetSink(std::move(sink), capacity);
+	}
+
+	bool HasSink() const
+	{
+		return m_buf.HasSink();
+	}
+
+	void Flush()
+	{
+		m_buf.Flush();
+	}
+
+	//the serializer knows the shape of the json, so the separators are written by the caller.
 	void StartObject()
 	{
-		m_writer.StartObject();
+		m_buf.Put('{');
 	}
 
 	void EndObject()
 	{
-		m_writer.EndObject();
+		m_buf.Put('}');
 	}
 
 	void StartArray()
 	{
-		m_writer.StartArray();
+		m_buf.Put('[');
 	}
 
 	void EndArray()
 	{
-		m_writer.EndArray();
+		m_buf.Put(']');
+	}
+
+	void WriteSeparator()
+	{
+		m_buf.Put(',');
+	}
+
+	//writes "key":
+	void WriteKey(const char* key, size_t length)
+	{
+		WriteString(key, length);
+		m_buf.Put(':');
+	}
+
+	//the number keys of the maps, the digits are written straight into the buffer.
+	void WriteKey(int64_t key)
+	{
+		m_buf.Put('"');
+		WriteInt64(key);
+		m_buf.Write("\":", 2);
+	}
+
+	void WriteKey(uint64_t key)
+	{
+		m_buf.Put('"');
+		WriteUint64(key);
+		m_buf.Write("\":", 2);
+	}
+
+	//the double keys are always exact, whatever the format of the values.
+	void WriteKey(double key)
+	{
+		m_buf.Put('"');
+		WriteDouble(key, &shortest::Write);
+		m_buf.Write("\":", 2);
+	}
+
+	void WriteKey(float key)
+	{
+		m_buf.Put('"');
+		WriteFloat(key);
+		m_buf.Write("\":", 2);
+	}
+
+	void WriteRaw(const char* str, size_t length)
+	{
+		m_buf.Write(str, length);
 	}
 
 	void WriteValue(const char* val)
 	{
 		if (val == nullptr)
-			m_writer.Null();
+			WriteNull();
 		else
-			m_writer.String(val);
+			WriteString(val, std::strlen(val));
 	}
 
-	void ReadValue(char*& t, rapidjson::Value& val)
+	static void ReadValue(char*& t, rapidjson::Value& val)
 	{
 		if (val.IsString())
 			t = (char*)val.GetString();
@@ -74,44 +266,92 @@ public:
 
 	void WriteValue(const std::string& val)
 	{
-		m_writer.String(val.c_str());
+		WriteString(val.c_str(), val.length());
 	}
 
-	void ReadValue(std::string& t, rapidjson::Value& val)
+	static void ReadValue(std::string& t, rapidjson::Value& val)
 	{
 		if(val.IsString())
-			t = val.GetString();
+			t.assign(val.GetString(), val.GetStringLength());
 	}
 
-	void Parse(const char* json)
+	void WriteValue(boost::string_ref val)
 	{
-		auto& r = m_doc.Parse<0>(json);
-		if (r.HasParseError())
-		{
-			throw std::invalid_argument("json string parse failed");
-		}
+		WriteString(val.data(), val.length());
 	}
 
-	void Parse(const char* json, std::size_t length)
+	//the view points into the document or the text parsed in place, valid until the next Parse.
+	static void ReadValue(boost::string_ref& t, rapidjson::Value& val)
 	{
-		auto& r = m_doc.Parse<0>(json, length);
-		if (r.HasParseError())
-		{
-			throw std::invalid_argument("json string parse failed");
-		}
+		if (val.IsString())
+			t = boost::string_ref(val.GetString(), val.GetStringLength());
+	}
+
+#ifdef KAPOK_HAS_STRING_VIEW
+	void WriteValue(std::string_view val)
+	{
+		WriteString(val.data(), val.length());
+	}
+
+	static void ReadValue(std::string_view& t, rapidjson::Value& val)
+	{
+		if (val.IsString())
+			t = std::string_view(val.GetString(), val.GetStringLength());
+	}
+#endif
+
+	rapidjson::ParseResult Parse(const char* json)
+	{
+		return Parse(json, std::strlen(json));
+	}
+
+	//the text is copied once and the copy is parsed in place: the reader then hands each number
+	//over as its text without copying it, and NumberHandler converts it once. The strings of the
+	//document point into the copy until the next Parse.
+	rapidjson::ParseResult Parse(const char* json, std::size_t length)
+	{
+		detail::InsituBufferStream is(m_text.Assign(json, length), length);
+		return ParseStream<rapidjson::kParseInsituFlag>(is);
+	}
+
+	//parses a read-only buffer without copying it first: the document copies the strings and does
+	//not point into the buffer, which may be released after the parse.
+	rapidjson::ParseResult ParseCopy(const char* json, std::size_t length)
+	{
+		rapidjson::MemoryStream is(json, length);
+		return ParseStream<0>(is);
+	}
+
+	//parses the caller's buffer in place without copying it: the strings are unescaped into the
+	//buffer, the document and the views read from it point there. The buffer must outlive them.
+	rapidjson::ParseResult ParseInsitu(char* json, std::size_t length)
+	{
+		detail::InsituBufferStream is(json, length);
+		return ParseStream<rapidjson::kParseInsituFlag>(is);
+	}
+
+	rapidjson::ParseResult ParseInsitu(char* json)
+	{
+		rapidjson::InsituStringStream is(json);
+		return ParseStream<rapidjson::kParseInsituFlag>(is);
+	}
+
+	Document& GetDocument()
+	{
+		return m_pool.GetDocument();
 	}
 
-    rapidjson::Document& GetDocument()
+	DocumentPool& GetPool()
 	{
-		return m_doc;
+		return m_pool;
 	}
 
 	void WriteValue(uint8_t val)
 	{
-		m_writer.Int(val);
+		WriteInt(val);
 	}
 
-	void ReadValue(uint8_t& t, rapidjson::Value& val)
+	static void ReadValue(uint8_t& t, rapidjson::Value& val)
 	{
 		if (val.IsInt())
 			t = (uint8_t)val.GetInt();
@@ -119,10 +359,10 @@ public:
 
 	void WriteValue(int8_t val)
 	{
-		m_writer.Int(val);
+		WriteInt(val);
 	}
 
-	void ReadValue(int8_t& t, rapidjson::Value& val)
+	static void ReadValue(int8_t& t, rapidjson::Value& val)
 	{
 		if (val.IsInt())
 			t = (int8_t)val.GetInt();
@@ -130,10 +370,10 @@ public:
 
 	void WriteValue(int16_t val)
 	{
-		m_writer.Int(val);
+		WriteInt(val);
 	}
 
-	void ReadValue(int16_t& t, rapidjson::Value& val)
+	static void ReadValue(int16_t& t, rapidjson::Value& val)
 	{
 		if (val.IsInt())
 			t = (int16_t)val.GetInt();
@@ -141,10 +381,10 @@ public:
 
 	void WriteValue(uint16_t val)
 	{
-		m_writer.Int(val);
+		WriteInt(val);
 	}
 
-	void ReadValue(uint16_t& t, rapidjson::Value& val)
+	static void ReadValue(uint16_t& t, rapidjson::Value& val)
 	{
 		if (val.IsInt())
 			t = (uint16_t)val.GetInt();
@@ -152,10 +392,10 @@ public:
 
 	void WriteValue(int val)
 	{
-		m_writer.Int(val);
+		WriteInt(val);
 	}
 
-	void ReadValue(int& t, rapidjson::Value& val)
+	static void ReadValue(int& t, rapidjson::Value& val)
 	{
 		if (val.IsInt())
 			t = val.GetInt();
@@ -163,10 +403,10 @@ public:
 
 	void WriteValue(char val)
 	{
-		m_writer.Int(val);
+		WriteInt(val);
 	}
 
-	void ReadValue(char& t, rapidjson::Value& val)
+	static void ReadValue(char& t, rapidjson::Value& val)
 	{
 		if(val.IsInt())
 			t = (char)val.GetInt();
@@ -174,10 +414,10 @@ public:
 
 	void WriteValue(uint32_t val)
 	{
-		m_writer.Uint(val);
+		WriteUint(val);
 	}
 
-	void ReadValue(uint32_t& t, rapidjson::Value& val)
+	static void ReadValue(uint32_t& t, rapidjson::Value& val)
 	{
 		if (val.IsUint())
 			t = val.GetUint();
@@ -185,10 +425,10 @@ public:
 
 	void WriteValue(int64_t val)
 	{
-		m_writer.Int64(val);
+		WriteInt64(val);
 	}
 
-	void ReadValue(int64_t& t, rapidjson::Value& val)
+	static void ReadValue(int64_t& t, rapidjson::Value& val)
 	{
 		if(val.IsInt64())
 			t = val.GetInt64();
@@ -196,10 +436,10 @@ public:
 
 	void WriteValue(uint64_t val)
 	{
-		m_writer.Uint64(val);
+		WriteUint64(val);
 	}
 
-	void ReadValue(uint64_t& t, rapidjson::Value& val)
+	static void ReadValue(uint64_t& t, rapidjson::Value& val)
 	{
 		if(val.IsUint64())
 			t = val.GetUint64();
@@ -207,10 +447,10 @@ public:
 
 	void WriteValue(double val)
 	{
-		m_writer.Double(val);
+		WriteDouble(val);
 	}
 
-	void ReadValue(double& t, rapidjson::Value& val)
+	static void ReadValue(double& t, rapidjson::Value& val)
 	{
 		if (val.IsNumber())
 			t = val.GetDouble();
@@ -218,19 +458,53 @@ public:
 
 	void WriteValue(float val)
 	{
-		m_writer.Double(static_cast<double>(val));
+		WriteFloat(val);
+	}
+
+	//the integers are converted directly, the doubles are rounded to float. That is the float
+	//nearest to the number text but for a double exactly in the middle of two floats, those are
+	//recorded while parsing only with SetExactFloats (see detail::to_float).
+	void ReadValue(float& t, rapidjson::Value& val) const
+	{
+		if (!val.IsNumber())
+			return;
+
+		if (!val.IsDouble())
+		{
+			t = val.IsInt64() ? static_cast<float>(val.GetInt64()) : static_cast<float>(val.GetUint64());
+			return;
+		}
+
+		const double d = val.GetDouble();
+		t = static_cast<float>(d);
+		if (m_floats->empty())
+			return;
+
+		auto it = std::lower_bound(m_floats->begin(), m_floats->end(), &val, [](const FloatValue& f, const rapidjson::Value* v) { return f.value < v; });
+		if (it != m_floats->end() && it->value == &val && it->d == d)
+			t = it->f;
+	}
+
+	//the parses record the doubles in the middle of two floats, so that ReadValue(float&) reads the
+	//float nearest to their text. Off by default, it costs every parse a count of the values.
+	void SetExactFloats(bool exact)
+	{
+		m_exact_floats = exact;
 	}
 
-	void ReadValue(float& t, rapidjson::Value& val)
+	//the readers sharing the document of another JsonUtil read its floats like it.
+	void ShareFloats(const JsonUtil& parser)
 	{
-		if(val.IsNumber())
-			t = static_cast<float>(val.GetDouble());
+		m_floats = &parser.m_float_values;
 	}
 
 	template<typename T>
 	typename std::enable_if<std::is_same<T, bool>::value>::type WriteValue(T val)
 	{
-		m_writer.Bool(val);
+		if (val)
+			m_buf.Write("true", 4);
+		else
+			m_buf.Write("false", 5);
 	}
 
 	//还要过滤智能指针的情况.
@@ -238,15 +512,19 @@ public:
 	typename std::enable_if<is_pointer_ext<T>::value>::type WriteValue(T val)
 	{
 		//不支持动态指针的原因是反序列化的时候涉及到指针的内存管理，反序列化不应该考虑为对象分配内存.
+#ifdef KAPOK_NO_EXCEPTIONS
+		static_assert(!is_pointer_ext<T>::value, "not surpport dynamic pointer");
+#else
 		throw std::invalid_argument("not surpport dynamic pointer");
+#endif
 	}
 
 	void WriteNull()
 	{
-		m_writer.Null();
+		m_buf.Write("null", 4);
 	}
 
-	void ReadValue(bool& t, rapidjson::Value& val)
+	static void ReadValue(bool& t, rapidjson::Value& val)
 	{
 		if(val.IsBool())
 			t = val.GetBool();
@@ -257,10 +535,261 @@ public:
 		return m_buf.GetString();
 	}
 
+	size_t GetJsonLength() const
+	{
+		return m_buf.GetSize();
+	}
+
+	//the json text without the terminating zero.
+	const char* GetJsonData() const
+	{
+		return m_buf.GetData();
+	}
+
+	std::string ReleaseJson()
+	{
+		return m_buf.Release();
+	}
+
+	template<typename Container>
+	void Attach(Container& container)
+	{
+		m_buf.Attach(container);
+	}
+
+	void Detach()
+	{
+		m_buf.Detach();
+	}
+
 private:
-    rapidjson::StringBuffer m_buf; //json字符串的buf.
-	JsonWriter m_writer; //json写入器.
-    rapidjson::Document m_doc;
-};
-} // namespace kapok
+	void WriteInt(int val)
+	{
+		m_buf.Commit(rapidjson::internal::i32toa(val, m_buf.Reserve(11)));
+	}
+
+	void WriteUint(unsigned val)
+	{
+		m_buf.Commit(rapidjson::internal::u32toa(val, m_buf.Reserve(10)));
+	}
+
+	void WriteInt64(int64_t val)
+	{
+		m_buf.Commit(rapidjson::internal::i64toa(val, m_buf.Reserve(20)));
+	}
+
+	void WriteUint64(uint64_t val)
+	{
+		m_buf.Commit(rapidjson::internal::u64toa(val, m_buf.Reserve(20)));
+	}
 
+	void WriteDouble(double val)
+	{
+		WriteDouble(val, m_double_format);
+	}
+
+	void WriteDouble(double val, DoubleFormat format)
+	{
+		//json has no NaN and Infinity.
+		if (rapidjson::internal::Double(val).IsNanOrInf())
+		{
+			WriteNull();
+			return;
+		}
+
+		m_buf.Commit(format(val, m_buf.Reserve(32)));
+	}
+
+	void WriteFloat(float val)
+	{
+		if (rapidjson::internal::Double(val).IsNanOrInf())
+		{
+			WriteNull();
+			return;
+		}
+
+		m_buf.Commit(detail::ftoa(val, m_buf.Reserve(25)));
+	}
+
+	//same escaping as rapidjson::Writer, the runs without escapes are found by find_escape and copied at once.
+	void WriteString(const char* str, size_t length)
+	{
+		static const char hexDigits[16] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' };
+		static const char escape[256] = {
+#define Z16 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0
+			//0    1    2    3    4    5    6    7    8    9    A    B    C    D    E    F
+			'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u', // 00
+			'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', // 10
+			  0,   0, '"',   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0, // 20
+			Z16, Z16,                                                                       // 30~4F
+			  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,'\\',   0,   0,   0, // 50
+			Z16, Z16, Z16, Z16, Z16, Z16, Z16, Z16, Z16, Z16                                // 60~FF
+#undef Z16
+		};
+
+		m_buf.Put('"');
+		const char* end = str + length;
+		while (str != end)
+		{
+			const char* run = str;
+			str = detail::find_escape(str, end);
+			m_buf.Write(run, str - run);
+			if (str == end)
+				break;
+
+			char* p = m_buf.Reserve(6);
+			unsigned char c = static_cast<unsigned char>(*str++);
+			*p++ = '\\';
+			*p++ = escape[c];
+			if (escape[c] == 'u')
+			{
+				*p++ = '0';
+				*p++ = '0';
+				*p++ = hexDigits[c >> 4];
+				*p++ = hexDigits[c & 0xF];
+			}
+			m_buf.Commit(p);
+		}
+		m_buf.Put('"');
+	}
+
+	//the document is built by SAX events so that the numbers are converted like NumberHandler does.
+	template<unsigned parseFlags, typename InputStream>
+	rapidjson::ParseResult ParseStream(InputStream& is)
+	{
+		m_pool.Reset();
+		m_float_events.clear();
+		m_float_values.clear();
+		rapidjson::ParseResult result;
+		auto generator = [this, &is, &result](Document& doc)
+		{
+			if (m_exact_floats)
+			{
+				FloatDocumentHandler handler{ doc, m_float_events, 0, nullptr, 0 };
+				result = detail::ParseRawNumbers<parseFlags>(m_reader, is, handler);
+			}
+			else
+			{
+				NumberHandler<Document> handler{ doc };
+				result = detail::ParseRawNumbers<parseFlags>(m_reader, is, handler);
+			}
+			return !result.IsError();
+		};
+		m_pool.GetDocument().Populate(generator);
+		if (!result.IsError() && !m_float_events.empty())
+			FindFloats();
+
+		return result;
+	}
+
+private:
+	// The side table of the floats: a double exactly in the middle of two floats whose text is not
+	// is cast to the wrong one, the float of its text is kept here by the address of its value in
+	// the document. It is only built with SetExactFloats, the handler then counts every value to
+	// find the recorded ones in the document. The table is usually empty.
+	struct FloatValue
+	{
+		const rapidjson::Value* value;
+		double d;	//the value is checked too, the document may have changed since.
+		float f;
+	};
+
+	struct FloatEvent
+	{
+		size_t index;	//of the value in document order.
+		double d;
+		float f;
+	};
+
+	// NumberHandler building the document which also counts the values in document order, and
+	// records the doubles a float would not read back as the nearest float of their text.
+	struct FloatDocumentHandler
+	{
+		Document& doc;
+		std::vector<FloatEvent>& floats;
+		size_t count;
+		const char* number;
+		size_t number_length;
+
+		bool Null() { ++count; return doc.Null(); }
+		bool Bool(bool b) { ++count; return doc.Bool(b); }
+		bool Int(int i) { ++count; return doc.Int(i); }
+		bool Uint(unsigned u) { ++count; return doc.Uint(u); }
+		bool Int64(int64_t i) { ++count; return doc.Int64(i); }
+		bool Uint64(uint64_t u) { ++count; return doc.Uint64(u); }
+
+		bool Double(double d)
+		{
+			++count;
+			float below;
+			if (detail::is_float_middle(d, below))
+			{
+				const float f = detail::to_float(d, number, number_length);
+				if (f != static_cast<float>(d))
+					floats.push_back(FloatEvent{ count - 1, d, f });
+			}
+
+			return doc.Double(d);
+		}
+
+		bool RawNumber(const char* str, rapidjson::SizeType length, bool)
+		{
+			number = str;
+			number_length = length;
+			return detail::parse_number(str, length, *this);
+		}
+
+		bool String(const char* str, rapidjson::SizeType length, bool copy) { ++count; return doc.String(str, length, copy); }
+		bool StartObject() { ++count; return doc.StartObject(); }
+		bool Key(const char* str, rapidjson::SizeType length, bool copy) { return doc.Key(str, length, copy); }
+		bool EndObject(rapidjson::SizeType members) { return doc.EndObject(members); }
+		bool StartArray() { ++count; return doc.StartArray(); }
+		bool EndArray(rapidjson::SizeType elements) { return doc.EndArray(elements); }
+	};
+
+	//the values moved into their arrays and objects, the recorded floats are found by walking the
+	//document in the order of the events.
+	void FindFloats()
+	{
+		size_t count = 0;
+		size_t next = 0;
+		FindFloats(m_pool.GetDocument(), count, next);
+		std::sort(m_float_values.begin(), m_float_values.end(), [](const FloatValue& a, const FloatValue& b) { return a.value < b.value; });
+	}
+
+	void FindFloats(const rapidjson::Value& v, size_t& count, size_t& next)
+	{
+		if (next == m_float_events.size())
+			return;
+
+		if (count++ == m_float_events[next].index)
+		{
+			m_float_values.push_back(FloatValue{ &v, m_float_events[next].d, m_float_events[next].f });
+			next++;
+			return;
+		}
+
+		if (v.IsObject())
+		{
+			for (auto it = v.MemberBegin(); it != v.MemberEnd(); ++it)
+				FindFloats(it->value, count, next);
+		}
+		else if (v.IsArray())
+		{
+			for (auto it = v.Begin(); it != v.End(); ++it)
+				FindFloats(*it, count, next);
+		}
+	}
+
+	JsonBuffer m_buf; //json字符串的buf.
+	DoubleFormat m_double_format = &shortest::Write;
+	DocumentPool m_pool; //the document and its memory, kept between the messages.
+	rapidjson::Reader m_reader; //keeps its stack between the documents.
+	detail::TextCopy m_text; //the copy of the text parsed by Parse.
+	size_t m_trim_size = 0;
+	std::vector<FloatEvent> m_float_events; //the doubles whose float is not their cast, in document order.
+	std::vector<FloatValue> m_float_values; //the same floats keyed by their value, sorted by address.
+	bool m_exact_floats = false;
+	const std::vector<FloatValue>* m_floats = &m_float_values;
+};
+} // namespace kapok
\ No newline at end of file
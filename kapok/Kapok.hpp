@@ -1,3 +1,6 @@
 #pragma once
 #include "Serializer.hpp"
 #include "DeSerializer.hpp"
+#include "SaxDeSerializer.hpp"
+#include "ProjectionDeSerializer.hpp"
+#include "Ndjson.hpp"
@@ -0,0 +1,91 @@
+#pragma once
+#include <limits>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <boost/lexical_cast.hpp>
+#include "traits.hpp"
+
+namespace kapok {
+namespace detail
+{
+	template<typename T>
+	struct is_integer_key : std::integral_constant<bool, std::is_integral<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value>
+	{
+	};
+
+	//the integer keys are parsed in place, the other keys go through lexical_cast. The key is
+	//converted into value, the result is nullptr or the error.
+	template<typename T>
+	typename std::enable_if<is_integer_key<T>::value, const char*>::type key_cast(const char* str, size_t length, T& value)
+	{
+		const char* end = str + length;
+		bool negative = std::is_signed<T>::value && str != end && *str == '-';
+		if (negative)
+			++str;
+
+		if (str == end)
+			return "the key is not an integer";
+
+		//the limit is -min for a negative value, which does not overflow in uint64_t.
+		const uint64_t limit = negative ? uint64_t(0) - static_cast<uint64_t>(std::numeric_limits<T>::min()) : static_cast<uint64_t>(std::numeric_limits<T>::max());
+		uint64_t n = 0;
+		for (; str != end; ++str)
+		{
+			unsigned digit = static_cast<unsigned char>(*str) - '0';
+			if (digit > 9)
+				return "the key is not an integer";
+
+			if (n > (limit - digit) / 10)
+				return "the key is out of range";
+
+			n = n * 10 + digit;
+		}
+
+		value = negative ? static_cast<T>(uint64_t(0) - n) : static_cast<T>(n);
+		return nullptr;
+	}
+
+	template<typename T>
+	typename std::enable_if<std::is_enum<T>::value, const char*>::type key_cast(const char* str, size_t length, T& value)
+	{
+		return key_cast(str, length, reinterpret_cast<typename std::underlying_type<T>::type&>(value));
+	}
+
+	template<typename T>
+	typename std::enable_if<is_string<T>::value, const char*>::type key_cast(const char* str, size_t length, T& value)
+	{
+		value = T(str, length);
+		return nullptr;
+	}
+
+	template<typename T>
+	typename std::enable_if<std::is_same<T, bool>::value, const char*>::type key_cast(const char* str, size_t length, T& value)
+	{
+		if (length == 4 && std::memcmp(str, "true", 4) == 0)
+		{
+			value = true;
+			return nullptr;
+		}
+
+		if (length == 5 && std::memcmp(str, "false", 5) == 0)
+		{
+			value = false;
+			return nullptr;
+		}
+
+		int n = 0;
+		const char* error = key_cast(str, length, n);
+		value = n != 0;
+		return error;
+	}
+
+	template<typename T>
+	typename std::enable_if<!is_integer_key<T>::value && !std::is_enum<T>::value && !is_string<T>::value && !std::is_same<T, bool>::value, const char*>::type
+		key_cast(const char* str, size_t length, T& value)
+	{
+		return boost::conversion::try_lexical_convert(str, length, value) ? nullptr : "the key can not be converted";
+	}
+}
+} // namespace kapok
@@ -0,0 +1,79 @@
+#pragma once
+#include "PerfectHash.hpp"
+
+namespace kapok {
+namespace detail
+{
+	//the field names are identifiers, so they never need to be escaped.
+	template<size_t N>
+	constexpr size_t fragments_length(const std::array<const char*, N>& names)
+	{
+		size_t length = 0;
+		for (size_t i = 0; i < N; i++)
+			length += const_strlen(names[i]) + (i == 0 ? 3 : 4);
+
+		return length;
+	}
+
+	template<size_t N, size_t Length>
+	struct key_fragment_table
+	{
+		char data[Length];
+		size_t offsets[N + 1];
+	};
+
+	template<size_t Length, size_t N>
+	constexpr key_fragment_table<N, Length> make_key_fragments(const std::array<const char*, N>& names)
+	{
+		key_fragment_table<N, Length> fragments{};
+		size_t pos = 0;
+		for (size_t i = 0; i < N; i++)
+		{
+			fragments.offsets[i] = pos;
+			if (i != 0)
+				fragments.data[pos++] = ',';
+
+			fragments.data[pos++] = '"';
+			for (const char* p = names[i]; *p != '\0'; ++p)
+				fragments.data[pos++] = *p;
+
+			fragments.data[pos++] = '"';
+			fragments.data[pos++] = ':';
+		}
+		fragments.offsets[N] = pos;
+		return fragments;
+	}
+}
+
+// Ready-made key fragments of the types declared with META: "name": for the first field and
+// ,"age": for the others, the serializer copies them and only formats the values.
+template<typename T>
+struct key_fragments
+{
+	using names_type = decltype(T::MetaNames());
+	static constexpr size_t size = std::tuple_size<names_type>::value;
+	static constexpr size_t length = detail::fragments_length(T::MetaNames());
+	using table_type = detail::key_fragment_table<size, length>;
+
+	static constexpr table_type table = detail::make_key_fragments<length>(T::MetaNames());
+
+	static const char* data(size_t index)
+	{
+		return table.data + table.offsets[index];
+	}
+
+	static size_t length_of(size_t index)
+	{
+		return table.offsets[index + 1] - table.offsets[index];
+	}
+};
+
+template<typename T>
+constexpr size_t key_fragments<T>::size;
+
+template<typename T>
+constexpr size_t key_fragments<T>::length;
+
+template<typename T>
+constexpr typename key_fragments<T>::table_type key_fragments<T>::table;
+} // namespace kapok
@@ -0,0 +1,122 @@
+#pragma once
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+#include "Common.hpp"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kapok {
+// A json file mapped into memory for the DeSerializer. The read-only mapping shares the pages of
+// the page cache. The private one is copy-on-write and never changes the file, but parsing it in
+// place writes every string back with its '\0', so nearly every page of a usual json file is
+// copied: it saves the read into a string, not the memory of a copy. The file must not be
+// truncated while it is mapped. Without mmap (Windows) the file is read into a buffer instead.
+class MappedFile : NonCopyable
+{
+public:
+	~MappedFile()
+	{
+		Close();
+	}
+
+	//maps the whole file, read-only or private and writable. The result is null on success,
+	//otherwise the reason of the failure.
+	const char* Open(const char* path, bool writable)
+	{
+		Close();
+#ifdef _WIN32
+		(void)writable;
+		FILE* fp = std::fopen(path, "rb");
+		if (fp == nullptr)
+			return "open json file failed";
+
+		char block[64 * 1024];
+		size_t n = 0;
+		while ((n = std::fread(block, 1, sizeof(block), fp)) != 0)
+			m_buffer.insert(m_buffer.end(), block, block + n);
+
+		const bool failed = std::ferror(fp) != 0;
+		std::fclose(fp);
+		if (failed)
+		{
+			Close();
+			return "read json file failed";
+		}
+
+		m_data = m_buffer.data();
+		m_size = m_buffer.size();
+		return nullptr;
+#else
+		int fd = -1;
+		do
+		{
+			fd = ::open(path, O_RDONLY);
+		} while (fd < 0 && errno == EINTR);
+
+		if (fd < 0)
+			return "open json file failed";
+
+		struct stat st;
+		if (::fstat(fd, &st) != 0)
+		{
+			::close(fd);
+			return "stat json file failed";
+		}
+
+		//an empty file can not be mapped, it is parsed as an empty text.
+		m_size = static_cast<size_t>(st.st_size);
+		if (m_size != 0)
+		{
+			void* p = ::mmap(nullptr, m_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p == MAP_FAILED)
+			{
+				::close(fd);
+				m_size = 0;
+				return "map json file failed";
+			}
+
+			m_data = static_cast<char*>(p);
+			::madvise(p, m_size, MADV_SEQUENTIAL);
+		}
+
+		::close(fd);
+		return nullptr;
+#endif
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		std::vector<char>().swap(m_buffer);
+#else
+		if (m_data != nullptr)
+			::munmap(m_data, m_size);
+#endif
+		m_data = nullptr;
+		m_size = 0;
+	}
+
+	char* Data() const
+	{
+		return m_data;
+	}
+
+	size_t Size() const
+	{
+		return m_size;
+	}
+
+private:
+	char* m_data = nullptr;
+	size_t m_size = 0;
+#ifdef _WIN32
+	std::vector<char> m_buffer;
+#endif
+};
+} // namespace kapok
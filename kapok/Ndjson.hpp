@@ -0,0 +1,163 @@
+#pragma once
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include "SaxDeSerializer.hpp"
+#include "Parallel.hpp"
+#include "Error.hpp"
+
+namespace kapok {
+namespace detail
+{
+	//the lines of a chunk are decoded by one worker, the chunks of a round in parallel.
+	template<typename T>
+	struct ndjson_chunk
+	{
+		const char* begin;
+		const char* end;
+		std::vector<T> records;
+		Error error;
+	};
+
+	inline const char* next_line(const char* p, const char* end)
+	{
+		const char* lf = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+		return lf != nullptr ? lf + 1 : end;
+	}
+
+	inline bool is_blank_line(const char* p, const char* end)
+	{
+		for (; p != end; ++p)
+		{
+			if (*p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+				return false;
+		}
+
+		return true;
+	}
+
+	//the chunks are a quarter of the share of a worker, between 4KB and 1MB, so a slow chunk
+	//does not hold the others and a big buffer is decoded in several rounds.
+	inline size_t ndjson_chunk_size(size_t length, size_t workers)
+	{
+		return (std::min)((std::max)(length / (workers * 4), size_t(4096)), size_t(1) << 20);
+	}
+
+	template<typename T>
+	void parse_ndjson_chunk(SaxDeSerializer& dr, ndjson_chunk<T>& chunk, const char* buffer)
+	{
+		chunk.records.clear();
+		chunk.error.Clear();
+		for (const char* line = chunk.begin; line != chunk.end;)
+		{
+			const char* next = next_line(line, chunk.end);
+			if (!is_blank_line(line, next))
+			{
+				chunk.records.emplace_back();
+				if (!dr.TryDeserialize(chunk.records.back(), line, static_cast<size_t>(next - line)))
+				{
+					const Error& error = dr.GetError();
+					const size_t offset = static_cast<size_t>(line - buffer);
+					chunk.error.Set(error.code, error.message, offset + (error.offset == Error::npos ? 0 : error.offset));
+					chunk.records.pop_back();
+					return;
+				}
+			}
+
+			line = next;
+		}
+	}
+}
+
+// Decodes newline-delimited json, one T per line, on the workers of pool. The buffer is cut at the
+// line ends into chunks, each worker reads its chunks with its own SaxDeSerializer, then the records
+// of a round are handed to sink(T&&) on the calling thread in the order of the lines. Blank lines
+// are skipped. At the first bad line the result is false, the records before it have been handed
+// over and error has its offset in the buffer.
+template<typename T, typename Sink>
+bool try_parse_ndjson(const char* buffer, std::size_t length, ThreadPool& pool, Sink sink, Error& error)
+{
+	error.Clear();
+	const size_t workers = pool.Size();
+	const size_t chunk_size = detail::ndjson_chunk_size(length, workers);
+	std::unique_ptr<SaxDeSerializer[]> readers(new SaxDeSerializer[workers]);
+	std::vector<detail::ndjson_chunk<T>> chunks(workers * 4);
+
+	const char* end = buffer + length;
+	for (const char* p = buffer; p != end;)
+	{
+		size_t count = 0;
+		for (; count < chunks.size() && p != end; count++)
+		{
+			const char* cut = static_cast<size_t>(end - p) > chunk_size ? detail::next_line(p + chunk_size, end) : end;
+			chunks[count].begin = p;
+			chunks[count].end = cut;
+			p = cut;
+		}
+
+		pool.Run(count, [&](size_t i, size_t worker)
+		{
+			detail::parse_ndjson_chunk(readers[worker], chunks[i], buffer);
+		});
+
+		for (size_t i = 0; i < count; i++)
+		{
+			for (auto& record : chunks[i].records)
+				sink(std::move(record));
+
+			if (chunks[i].error)
+			{
+				error = chunks[i].error;
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+//the workers are threads threads (0 means one per core) started for this call, a pool kept by the
+//caller saves starting them for each buffer.
+template<typename T, typename Sink>
+bool try_parse_ndjson(const char* buffer, std::size_t length, std::size_t threads, Sink sink, Error& error)
+{
+	ThreadPool pool(threads);
+	return try_parse_ndjson<T>(buffer, length, pool, std::move(sink), error);
+}
+
+template<typename T, typename Sink>
+void parse_ndjson(const char* buffer, std::size_t length, ThreadPool& pool, Sink sink)
+{
+	Error error;
+	if (!try_parse_ndjson<T>(buffer, length, pool, std::move(sink), error))
+		KAPOK_THROW(std::invalid_argument(error.message));
+}
+
+template<typename T, typename Sink>
+void parse_ndjson(const char* buffer, std::size_t length, std::size_t threads, Sink sink)
+{
+	Error error;
+	if (!try_parse_ndjson<T>(buffer, length, threads, std::move(sink), error))
+		KAPOK_THROW(std::invalid_argument(error.message));
+}
+
+template<typename T>
+std::vector<T> parse_ndjson(const char* buffer, std::size_t length, std::size_t threads = 0)
+{
+	std::vector<T> records;
+	parse_ndjson<T>(buffer, length, threads, [&records](T&& t)
+	{
+		records.push_back(std::move(t));
+	});
+
+	return records;
+}
+
+template<typename T>
+std::vector<T> parse_ndjson(const std::string& buffer, std::size_t threads = 0)
+{
+	return parse_ndjson<T>(buffer.c_str(), buffer.length(), threads);
+}
+} // namespace kapok
@@ -0,0 +1,541 @@
+#pragma once
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include "rapidjson/reader.h"
+#include "rapidjson/internal/diyfp.h"
+#include "rapidjson/internal/biginteger.h"
+#include "PowerOfFive.hpp"
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace kapok {
+namespace detail
+{
+	struct uint128
+	{
+		uint64_t low;
+		uint64_t high;
+	};
+
+	inline uint128 full_multiplication(uint64_t a, uint64_t b)
+	{
+#if defined(__SIZEOF_INT128__)
+		const unsigned __int128 p = static_cast<unsigned __int128>(a) * b;
+		return uint128{ static_cast<uint64_t>(p), static_cast<uint64_t>(p >> 64) };
+#elif defined(_MSC_VER) && defined(_M_X64)
+		uint128 r;
+		r.low = _umul128(a, b, &r.high);
+		return r;
+#else
+		const uint64_t a_lo = a & 0xFFFFFFFF;
+		const uint64_t a_hi = a >> 32;
+		const uint64_t b_lo = b & 0xFFFFFFFF;
+		const uint64_t b_hi = b >> 32;
+		const uint64_t lo_lo = a_lo * b_lo;
+		const uint64_t hi_lo = a_hi * b_lo;
+		const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + a_lo * b_hi;
+		return uint128{ (cross << 32) | (lo_lo & 0xFFFFFFFF), (hi_lo >> 32) + (cross >> 32) + a_hi * b_hi };
+#endif
+	}
+
+	inline double make_double(uint64_t bits)
+	{
+		double d;
+		std::memcpy(&d, &bits, sizeof(d));
+		return d;
+	}
+
+	// Eisel-Lemire: the double nearest to w * 10^q from the 128 bits product of w and 5^q, the
+	// product is always precise enough for a w of at most 19 digits (Mushtak and Lemire, "Fast
+	// Number Parsing Without Fallback").
+	inline double eisel_lemire(uint64_t w, int64_t q)
+	{
+		if (w == 0 || q < smallest_power_of_five)
+			return 0.0;
+
+		if (q > largest_power_of_five)
+			return std::numeric_limits<double>::infinity();
+
+		const rapidjson::internal::DiyFp normalized = rapidjson::internal::DiyFp(w, 0).Normalize();
+		const int lz = -normalized.e;
+		w = normalized.f;
+
+		const uint64_t* power = power_of_five_128() + 2 * (q - smallest_power_of_five);
+		uint128 product = full_multiplication(w, power[0]);
+		//the 55 bits needed by the rounding are exact unless the low bits of the high word are all ones.
+		if ((product.high & 0x1FF) == 0x1FF)
+		{
+			const uint128 second = full_multiplication(w, power[1]);
+			product.low += second.high;
+			if (second.high > product.low)
+				product.high++;
+		}
+
+		const int upperbit = static_cast<int>(product.high >> 63);
+		const int shift = upperbit + 64 - 52 - 3;
+		uint64_t mantissa = product.high >> shift;
+		const int q32 = static_cast<int>(q);
+		int power2 = (((152170 + 65536) * q32) >> 16) + 63 + upperbit - lz + 1023;
+		if (power2 <= 0)
+		{
+			//subnormal, a carry of the rounding may still make it the smallest normal.
+			if (-power2 + 1 >= 64)
+				return 0.0;
+
+			mantissa >>= -power2 + 1;
+			mantissa += mantissa & 1;
+			mantissa >>= 1;
+			power2 = mantissa < (uint64_t(1) << 52) ? 0 : 1;
+			return make_double(mantissa | (static_cast<uint64_t>(power2) << 52));
+		}
+
+		//exactly in the middle of two doubles: round half to even instead of up.
+		if (product.low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == product.high)
+			mantissa &= ~uint64_t(1);
+
+		mantissa += mantissa & 1;
+		mantissa >>= 1;
+		if (mantissa >= (uint64_t(2) << 52))
+		{
+			mantissa = uint64_t(1) << 52;
+			power2++;
+		}
+
+		mantissa &= ~(uint64_t(1) << 52);
+		if (power2 >= 0x7FF)
+			return std::numeric_limits<double>::infinity();
+
+		return make_double(mantissa | (static_cast<uint64_t>(power2) << 52));
+	}
+
+	inline double clinger_or_eisel_lemire(uint64_t w, int64_t q)
+	{
+		static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		//w and 10^q are both exact doubles, one rounding gives the result. x87 rounds twice.
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0
+		if (w <= (uint64_t(1) << 53) && q >= -22 && q <= 22)
+		{
+			const double d = static_cast<double>(w);
+			return q < 0 ? d / pow10[-q] : d * pow10[q];
+		}
+#endif
+
+		return eisel_lemire(w, q);
+	}
+
+	//the <<= of rapidjson's BigInteger moves the wrong words for a multiple of 64, which also puts
+	//its StrtodBigInteger off by an ulp, so such a shift is done in two.
+	inline void shift_left(rapidjson::internal::BigInteger& n, size_t shift)
+	{
+		if (shift != 0 && shift % 64 == 0)
+		{
+			n <<= shift - 1;
+			shift = 1;
+		}
+
+		n <<= shift;
+	}
+
+	// Compares the digits of a number (first to last, with the explicit exponent) exactly with
+	// (2 * significand + 1) * 2^exp2, the middle of two doubles or two floats. Digits past the
+	// 768th only matter as a nonzero sticky digit, such a middle never has that many.
+	inline int compare_with_middle(const char* first, const char* last, int64_t exponent, uint64_t significand, int exp2)
+	{
+		using rapidjson::internal::BigInteger;
+		static const size_t max_digits = 768;
+		char digits[max_digits + 1];
+		size_t length = 0;
+		bool point = false;
+		bool sticky = false;
+		for (const char* p = first; p != last; ++p)
+		{
+			if (*p == '.')
+			{
+				point = true;
+				continue;
+			}
+
+			if (length == 0 && *p == '0')
+			{
+				if (point)
+					exponent--;
+			}
+			else if (length < max_digits)
+			{
+				digits[length++] = *p;
+				if (point)
+					exponent--;
+			}
+			else
+			{
+				sticky = sticky || *p != '0';
+				if (!point)
+					exponent++;
+			}
+		}
+
+		if (sticky)
+		{
+			digits[length++] = '1';
+			exponent--;
+		}
+
+		if (length == 0 || static_cast<int64_t>(length) + exponent < -324)
+			return -1;
+
+		const int exp10 = static_cast<int>(exponent);
+		BigInteger value(digits, length);
+		BigInteger middle(2 * significand + 1);
+		if (exp10 >= 0)
+			value.MultiplyPow5(static_cast<unsigned>(exp10));
+		else
+			middle.MultiplyPow5(static_cast<unsigned>(-exp10));
+
+		if (exp10 > exp2)
+			shift_left(value, static_cast<size_t>(exp10 - exp2));
+		else
+			shift_left(middle, static_cast<size_t>(exp2 - exp10));
+
+		return value.Compare(middle);
+	}
+
+	// More than 19 significant digits where w and w + 1 round differently: the digits are compared
+	// exactly with the middle of below and the next double.
+	inline double round_long_digits(double below, const char* first, const char* last, int64_t exponent)
+	{
+		uint64_t bits;
+		std::memcpy(&bits, &below, sizeof(bits));
+		const int biased = static_cast<int>(bits >> 52);
+		const uint64_t significand = biased == 0 ? bits : (bits & ((uint64_t(1) << 52) - 1)) | (uint64_t(1) << 52);
+		const int exp2 = (biased == 0 ? -1074 : biased - 1075) - 1;
+
+		const int cmp = compare_with_middle(first, last, exponent, significand, exp2);
+		if (cmp < 0 || (cmp == 0 && (significand & 1) == 0))
+			return below;
+
+		return make_double(bits + 1);
+	}
+
+	inline bool is_digit(char c)
+	{
+		return static_cast<unsigned>(c - '0') < 10;
+	}
+
+	//accumulates the digits, eight at a time in a word on little endian targets.
+	inline const char* parse_digits(const char* p, const char* end, uint64_t& w)
+	{
+#if RAPIDJSON_ENDIAN == RAPIDJSON_LITTLEENDIAN
+		while (end - p >= 8)
+		{
+			uint64_t val;
+			std::memcpy(&val, p, sizeof(val));
+			if ((((val + 0x4646464646464646) | (val - 0x3030303030303030)) & 0x8080808080808080) != 0)
+				break;
+
+			val -= 0x3030303030303030;
+			val = (val * 10) + (val >> 8);
+			val = (((val & 0x000000FF000000FF) * 0x000F424000000064) + (((val >> 16) & 0x000000FF000000FF) * 0x0000271000000001)) >> 32;
+			w = w * 100000000 + static_cast<uint32_t>(val);
+			p += 8;
+		}
+#endif
+
+		for (; p != end && is_digit(*p); ++p)
+			w = 10 * w + static_cast<unsigned>(*p - '0');
+
+		return p;
+	}
+
+	// Converts the text of a number reported by a reader parsing with kParseNumbersAsStringsFlag,
+	// the reader already checked the grammar. The handler gets the event rapidjson would send,
+	// Int/Uint/Int64/Uint64 for the integers in range and Double otherwise, but correctly rounded.
+	// A double out of range fails like the handler, see number_too_big.
+	template<typename Handler>
+	bool parse_number(const char* str, size_t length, Handler& handler)
+	{
+		const char* p = str;
+		const char* const end = str + length;
+		const bool negative = *p == '-';
+		if (negative)
+			++p;
+
+		const char* const int_first = p;
+		uint64_t w = 0;
+		p = parse_digits(p, end, w);
+		const char* const int_last = p;
+		if (p == end)
+		{
+			const size_t int_digits = int_last - int_first;
+			if (int_digits < 20 || (int_digits == 20 && std::memcmp(int_first, "18446744073709551615", 20) <= 0))
+			{
+				if (!negative)
+					return w <= 0xFFFFFFFF ? handler.Uint(static_cast<unsigned>(w)) : handler.Uint64(w);
+
+				if (w <= uint64_t(1) << 31)
+					return handler.Int(static_cast<int>(static_cast<int64_t>(0) - static_cast<int64_t>(w)));
+
+				if (w <= uint64_t(1) << 63)
+					return handler.Int64(static_cast<int64_t>(~w + 1));
+			}
+		}
+
+		const char* frac_first = p;
+		const char* frac_last = p;
+		if (p != end && *p == '.')
+		{
+			frac_first = ++p;
+			p = parse_digits(p, end, w);
+			frac_last = p;
+		}
+
+		const char* const mantissa_last = p;
+		int64_t exp_number = 0;
+		if (p != end)
+		{
+			++p;
+			const bool exp_negative = *p == '-';
+			if (*p == '-' || *p == '+')
+				++p;
+
+			for (; p != end; ++p)
+			{
+				if (exp_number < 0x10000000)
+					exp_number = 10 * exp_number + (*p - '0');
+			}
+
+			if (exp_negative)
+				exp_number = -exp_number;
+		}
+
+		int64_t exponent = exp_number - (frac_last - frac_first);
+		size_t digit_count = (int_last - int_first) + (frac_last - frac_first);
+		if (digit_count > 19)
+		{
+			for (const char* s = int_first; s != mantissa_last && (*s == '0' || *s == '.'); ++s)
+			{
+				if (*s == '0')
+					digit_count--;
+			}
+		}
+
+		double d;
+		if (digit_count <= 19)
+		{
+			d = clinger_or_eisel_lemire(w, exponent);
+		}
+		else
+		{
+			//keep the first 19 significant digits, the value is between w and w + 1 at that scale.
+			const uint64_t min_19_digits = 1000000000000000000ULL;
+			w = 0;
+			const char* s = int_first;
+			for (; w < min_19_digits && s != int_last; ++s)
+				w = 10 * w + static_cast<unsigned>(*s - '0');
+
+			if (w >= min_19_digits)
+			{
+				exponent = (int_last - s) + exp_number;
+			}
+			else
+			{
+				for (s = frac_first; w < min_19_digits && s != frac_last; ++s)
+					w = 10 * w + static_cast<unsigned>(*s - '0');
+
+				exponent = (frac_first - s) + exp_number;
+			}
+
+			d = eisel_lemire(w, exponent);
+			if (d != eisel_lemire(w + 1, exponent))
+				d = round_long_digits(d, int_first, mantissa_last, exp_number);
+		}
+
+		if (!std::isfinite(d))
+			return false;
+
+		return handler.Double(negative ? -d : d);
+	}
+
+	struct AcceptNumber
+	{
+		bool Int(int) { return true; }
+		bool Uint(unsigned) { return true; }
+		bool Int64(int64_t) { return true; }
+		bool Uint64(uint64_t) { return true; }
+		bool Double(double) { return true; }
+	};
+
+	// Whether parse_number failed on the text because its double is out of range and not because
+	// of the handler, only asked once the parse stopped.
+	inline bool number_too_big(const char* str, size_t length)
+	{
+		AcceptNumber accept;
+		return !parse_number(str, length, accept);
+	}
+
+	// Forwards the events to Handler and remembers whether a number was too big, the reader then
+	// reports kParseErrorNumberTooBig like rapidjson instead of kParseErrorTermination.
+	template<typename Handler>
+	struct RawNumberHandler
+	{
+		Handler& handler;
+		bool too_big;
+
+		bool Null() { return handler.Null(); }
+		bool Bool(bool b) { return handler.Bool(b); }
+		bool Int(int i) { return handler.Int(i); }
+		bool Uint(unsigned u) { return handler.Uint(u); }
+		bool Int64(int64_t i) { return handler.Int64(i); }
+		bool Uint64(uint64_t u) { return handler.Uint64(u); }
+		bool Double(double d) { return handler.Double(d); }
+
+		bool RawNumber(const char* str, rapidjson::SizeType length, bool copy)
+		{
+			if (handler.RawNumber(str, length, copy))
+				return true;
+
+			too_big = number_too_big(str, length);
+			return false;
+		}
+
+		bool String(const char* str, rapidjson::SizeType length, bool copy) { return handler.String(str, length, copy); }
+		bool StartObject() { return handler.StartObject(); }
+		bool Key(const char* str, rapidjson::SizeType length, bool copy) { return handler.Key(str, length, copy); }
+		bool EndObject(rapidjson::SizeType count) { return handler.EndObject(count); }
+		bool StartArray() { return handler.StartArray(); }
+		bool EndArray(rapidjson::SizeType count) { return handler.EndArray(count); }
+	};
+
+	//the reader hands the numbers over to Handler::RawNumber as their text, copied on its stack or
+	//in place for an in-situ stream.
+	template<unsigned parseFlags, typename InputStream, typename Handler>
+	rapidjson::ParseResult ParseRawNumbers(rapidjson::Reader& reader, InputStream& is, Handler& handler)
+	{
+		RawNumberHandler<Handler> numbers{ handler, false };
+		rapidjson::ParseResult result = reader.Parse<parseFlags | rapidjson::kParseNumbersAsStringsFlag>(is, numbers);
+		if (numbers.too_big)
+			result.Set(rapidjson::kParseErrorNumberTooBig, result.Offset());
+
+		return result;
+	}
+
+	// Whether the double is exactly in the middle of two floats, below is then the lower one. It is
+	// the only double where static_cast<float> of the correctly rounded double may be wrong:
+	// the digits can be on either side of the middle while the cast rounds to even. The low 28
+	// bits of such a double are zero, the others are rejected at once.
+	inline bool is_float_middle(double d, float& below)
+	{
+		uint64_t bits;
+		std::memcpy(&bits, &d, sizeof(bits));
+		if ((bits & 0xFFFFFFF) != 0)
+			return false;
+
+		const double a = d < 0 ? -d : d;
+		float f = static_cast<float>(a);
+		if (static_cast<double>(f) == a)
+			return false;
+
+		if (static_cast<double>(f) > a)
+			f = std::nextafter(f, 0.0f);
+
+		uint32_t fbits;
+		std::memcpy(&fbits, &f, sizeof(fbits));
+		const int biased = static_cast<int>(fbits >> 23);
+		const double half_ulp = std::ldexp(1.0, (biased == 0 ? -149 : biased - 150) - 1);
+		below = f;
+		return static_cast<double>(f) + half_ulp == a;
+	}
+
+	// The float nearest to the number text whose correctly rounded double is d, the text is only
+	// looked at when d is in the middle of two floats.
+	inline float to_float(double d, const char* str, size_t length)
+	{
+		float below;
+		if (!is_float_middle(d, below))
+			return static_cast<float>(d);
+
+		const bool negative = *str == '-';
+		const char* first = str + negative;
+		const char* const end = str + length;
+		const char* last = first;
+		while (last != end && *last != 'e' && *last != 'E')
+			++last;
+
+		int64_t exponent = 0;
+		if (last != end)
+		{
+			const char* p = last + 1;
+			const bool exp_negative = *p == '-';
+			if (*p == '-' || *p == '+')
+				++p;
+
+			for (; p != end; ++p)
+			{
+				if (exponent < 0x10000000)
+					exponent = 10 * exponent + (*p - '0');
+			}
+
+			if (exp_negative)
+				exponent = -exponent;
+		}
+
+		uint32_t bits;
+		std::memcpy(&bits, &below, sizeof(bits));
+		const int biased = static_cast<int>(bits >> 23);
+		const uint64_t significand = biased == 0 ? bits : (bits & 0x7FFFFF) | 0x800000;
+		const int exp2 = (biased == 0 ? -149 : biased - 150) - 1;
+		const int cmp = compare_with_middle(first, last, exponent, significand, exp2);
+		if (cmp == 0)
+			return static_cast<float>(d);
+
+		const float f = cmp < 0 ? below : std::nextafter(below, std::numeric_limits<float>::infinity());
+		return negative ? -f : f;
+	}
+}
+
+// The parse flags which hand the numbers over to NumberHandler.
+static const unsigned kParseNumberFlags = rapidjson::kParseNumbersAsStringsFlag;
+
+// Forwards the events of a rapidjson::Reader parsing with kParseNumberFlags to Handler and
+// converts the numbers itself: the doubles are correctly rounded (Eisel-Lemire, with an exact
+// fallback) at the cost of the default flags, where rapidjson may be off by an ulp and
+// kParseFullPrecisionFlag is much slower. Handler may be a rapidjson::Document (see Populate).
+template<typename Handler>
+struct NumberHandler
+{
+	Handler& handler;
+
+	bool Null() { return handler.Null(); }
+	bool Bool(bool b) { return handler.Bool(b); }
+	bool Int(int i) { return handler.Int(i); }
+	bool Uint(unsigned u) { return handler.Uint(u); }
+	bool Int64(int64_t i) { return handler.Int64(i); }
+	bool Uint64(uint64_t u) { return handler.Uint64(u); }
+	bool Double(double d) { return handler.Double(d); }
+
+	bool RawNumber(const char* str, rapidjson::SizeType length, bool)
+	{
+		return detail::parse_number(str, length, handler);
+	}
+
+	bool String(const char* str, rapidjson::SizeType length, bool copy) { return handler.String(str, length, copy); }
+	bool StartObject() { return handler.StartObject(); }
+	bool Key(const char* str, rapidjson::SizeType length, bool copy) { return handler.Key(str, length, copy); }
+	bool EndObject(rapidjson::SizeType count) { return handler.EndObject(count); }
+	bool StartArray() { return handler.StartArray(); }
+	bool EndArray(rapidjson::SizeType count) { return handler.EndArray(count); }
+};
+
+// Parses a stream into the handler, the numbers go through NumberHandler.
+template<unsigned parseFlags, typename InputStream, typename Handler>
+rapidjson::ParseResult ParseNumbers(rapidjson::Reader& reader, InputStream& is, Handler& handler)
+{
+	NumberHandler<Handler> numbers{ handler };
+	return detail::ParseRawNumbers<parseFlags>(reader, is, numbers);
+}
+} // namespace kapok
@@ -0,0 +1,161 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <exception>
+#include "Common.hpp"
+#include "Error.hpp"
+
+namespace kapok {
+namespace detail
+{
+	//the threads of a parallel call, 0 means one per core.
+	inline size_t thread_count(size_t threads)
+	{
+		if (threads != 0)
+			return threads;
+
+		const size_t cores = std::thread::hardware_concurrency();
+		return cores != 0 ? cores : 1;
+	}
+}
+
+// Worker threads kept between the parallel calls, so a call only wakes them up. The pool has
+// threads workers (0 means one per core) and the calling thread of Run is worker 0, the others
+// wait for the tasks of the next Run. One Run at a time, a task must not call Run.
+class ThreadPool : NonCopyable
+{
+public:
+	explicit ThreadPool(size_t threads = 0) : m_size(detail::thread_count(threads))
+	{
+		m_threads.reserve(m_size - 1);
+		for (size_t w = 1; w < m_size; w++)
+			m_threads.emplace_back(&ThreadPool::Work, this, w);
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+
+		m_start.notify_all();
+		for (auto& t : m_threads)
+			t.join();
+	}
+
+	size_t Size() const
+	{
+		return m_size;
+	}
+
+	// Runs task(index, worker) for every index in [0, count) on up to Size() workers. The indexes
+	// are taken in order from a shared counter, so the tasks should be small enough to balance the
+	// load. The first exception of a task is rethrown once every worker has stopped.
+	template<typename Task>
+	void Run(size_t count, Task task)
+	{
+		const size_t workers = (std::min)(m_size, count);
+		if (workers <= 1)
+		{
+			for (size_t i = 0; i < count; i++)
+				task(i, size_t(0));
+
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_call = [](void* context, size_t i, size_t worker) { (*static_cast<Task*>(context))(i, worker); };
+			m_context = &task;
+			m_count = count;
+			m_next = 0;
+			m_workers = workers;
+			m_active = workers - 1;
+#ifndef KAPOK_NO_EXCEPTIONS
+			m_error = nullptr;
+			m_failed.clear();
+#endif
+			m_generation++;
+		}
+
+		m_start.notify_all();
+		Drain(0);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [this] { return m_active == 0; });
+#ifndef KAPOK_NO_EXCEPTIONS
+		if (m_error)
+			std::rethrow_exception(m_error);
+#endif
+	}
+
+private:
+	//a worker left out of a Run with fewer tasks than workers waits for the next one.
+	void Work(size_t worker)
+	{
+		size_t generation = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_start.wait(lock, [this, generation] { return m_stop || m_generation != generation; });
+				if (m_stop)
+					return;
+
+				generation = m_generation;
+				if (worker >= m_workers)
+					continue;
+			}
+
+			Drain(worker);
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (--m_active == 0)
+				m_done.notify_one();
+		}
+	}
+
+	void Drain(size_t worker)
+	{
+#ifndef KAPOK_NO_EXCEPTIONS
+		try
+		{
+#endif
+			for (size_t i = m_next++; i < m_count; i = m_next++)
+				m_call(m_context, i, worker);
+#ifndef KAPOK_NO_EXCEPTIONS
+		}
+		catch (...)
+		{
+			m_next = m_count;
+			if (!m_failed.test_and_set())
+				m_error = std::current_exception();
+		}
+#endif
+	}
+
+	const size_t m_size;
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_start;
+	std::condition_variable m_done;
+	bool m_stop = false;
+	size_t m_generation = 0;
+
+	//the tasks of the current Run, set under the lock before the workers are woken up.
+	void(*m_call)(void*, size_t, size_t) = nullptr;
+	void* m_context = nullptr;
+	size_t m_count = 0;
+	std::atomic<size_t> m_next{ 0 };
+	size_t m_workers = 0;
+	size_t m_active = 0;
+#ifndef KAPOK_NO_EXCEPTIONS
+	std::exception_ptr m_error;
+	std::atomic_flag m_failed = ATOMIC_FLAG_INIT;
+#endif
+};
+} // namespace kapok
@@ -0,0 +1,185 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace kapok {
+namespace detail
+{
+	constexpr size_t const_strlen(const char* str)
+	{
+		size_t n = 0;
+		while (str[n] != '\0')
+			++n;
+
+		return n;
+	}
+
+	constexpr uint64_t fnv1a(const char* str, size_t length)
+	{
+		uint64_t h = 14695981039346656037ULL;
+		for (size_t i = 0; i < length; i++)
+		{
+			h ^= static_cast<unsigned char>(str[i]);
+			h *= 1099511628211ULL;
+		}
+
+		return h;
+	}
+
+	constexpr uint64_t hash_mix(uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+	constexpr size_t next_pow2(size_t n)
+	{
+		size_t m = 1;
+		while (m < n)
+			m <<= 1;
+
+		return m;
+	}
+
+	// hash and displace: a key goes to bucket h % N, every bucket has a displacement d chosen at
+	// compile time so that hash_mix(h + d) puts all keys of all buckets into distinct slots.
+	template<size_t N>
+	struct perfect_hash_table
+	{
+		static constexpr size_t slot_count = next_pow2(2 * N);
+
+		uint16_t slots[slot_count];		//field index + 1, 0 means empty.
+		uint32_t displacement[N];
+		size_t lengths[N];
+	};
+
+	//not constexpr, reaching it while building the table at compile time is a compile error.
+	inline void perfect_hash_not_found() {}
+
+	template<size_t N>
+	constexpr perfect_hash_table<N> make_perfect_hash(const std::array<const char*, N>& names)
+	{
+		const size_t slot_count = perfect_hash_table<N>::slot_count;
+		perfect_hash_table<N> table{};
+		uint64_t hashes[N] = {};
+		size_t counts[N] = {};
+		for (size_t i = 0; i < N; i++)
+		{
+			table.lengths[i] = const_strlen(names[i]);
+			hashes[i] = fnv1a(names[i], table.lengths[i]);
+			counts[hashes[i] % N]++;
+		}
+
+		//place the biggest buckets first.
+		for (size_t size = N; size > 0; size--)
+		{
+			for (size_t b = 0; b < N; b++)
+			{
+				if (counts[b] != size)
+					continue;
+
+				for (uint32_t d = 1; ; d++)
+				{
+					if (d > 1000000)
+					{
+						perfect_hash_not_found();
+						return table;
+					}
+
+					size_t taken[N] = {};
+					size_t n = 0;
+					bool ok = true;
+					for (size_t i = 0; i < N && ok; i++)
+					{
+						if (hashes[i] % N != b)
+							continue;
+
+						size_t slot = hash_mix(hashes[i] + d) & (slot_count - 1);
+						ok = table.slots[slot] == 0;
+						for (size_t j = 0; j < n && ok; j++)
+							ok = taken[j] != slot;
+
+						taken[n++] = slot;
+					}
+
+					if (!ok)
+						continue;
+
+					n = 0;
+					for (size_t i = 0; i < N; i++)
+					{
+						if (hashes[i] % N == b)
+							table.slots[taken[n++]] = static_cast<uint16_t>(i + 1);
+					}
+
+					table.displacement[b] = d;
+					break;
+				}
+			}
+		}
+
+		return table;
+	}
+
+	template<typename T>
+	struct has_meta_names
+	{
+	private:
+		template<typename U> static auto Check(int) -> decltype(U::MetaNames(), std::true_type());
+		template<typename U> static std::false_type Check(...);
+
+	public:
+		enum
+		{
+			value = std::is_same<decltype(Check<T>(0)), std::true_type>::value
+		};
+	};
+}
+
+// Compile-time field name lookup for the types declared with META.
+template<typename T>
+struct field_table
+{
+	using names_type = decltype(T::MetaNames());
+	static constexpr size_t npos = static_cast<size_t>(-1);
+	static constexpr size_t size = std::tuple_size<names_type>::value;
+	using table_type = detail::perfect_hash_table<size>;
+
+	static constexpr names_type names = T::MetaNames();
+	static constexpr table_type table = detail::make_perfect_hash(names);
+
+	//returns the index of the field, or npos when T has no such field.
+	static size_t find(const char* key, size_t length)
+	{
+		uint64_t h = detail::fnv1a(key, length);
+		size_t slot = detail::hash_mix(h + table.displacement[h % size]) & (table.slot_count - 1);
+		size_t index = table.slots[slot];
+		if (index == 0)
+			return npos;
+
+		--index;
+		if (table.lengths[index] != length || std::memcmp(names[index], key, length) != 0)
+			return npos;
+
+		return index;
+	}
+};
+
+template<typename T>
+constexpr size_t field_table<T>::npos;
+
+template<typename T>
+constexpr size_t field_table<T>::size;
+
+template<typename T>
+constexpr typename field_table<T>::names_type field_table<T>::names;
+
+template<typename T>
+constexpr typename field_table<T>::table_type field_table<T>::table;
+} // namespace kapok
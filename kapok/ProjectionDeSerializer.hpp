@@ -0,0 +1,415 @@
+#pragma once
+#include <cstring>
+#include <bitset>
+#include <vector>
+#include <string>
+#include "traits.hpp"
+#include "PerfectHash.hpp"
+#include "SaxDeSerializer.hpp"
+#include "Error.hpp"
+#include "rapidjson/reader.h"
+#include "rapidjson/memorystream.h"
+#include "rapidjson/error/en.h"
+
+namespace kapok {
+// Reads a META type from a large json text by walking the text itself: the members the type does
+// not declare are skipped by matching the brackets and the quotes only, without tokenizing or
+// allocating. The nested META members are walked the same way, every other wanted value is
+// copied out and read by a SaxDeSerializer once the walk is done, so the cost of the read values
+// does not depend on the size of the text.
+//
+// The skipped values are not validated. The boost::string_ref/std::string_view members point into
+// the copies of the wanted values, valid until the next Deserialize.
+class ProjectionDeSerializer : NonCopyable
+{
+	//a wanted value, read after the walk so the copies are not moved by a later one.
+	struct Pending
+	{
+		bool(*read)(ProjectionDeSerializer&, void*, char*, size_t);
+		void* obj;
+		size_t offset;	//in the json text.
+		size_t length;
+	};
+
+	static const size_t npos = static_cast<size_t>(-1);
+
+public:
+	template<typename T>
+	void Deserialize(T& t, const std::string& jsonText)
+	{
+		Deserialize(t, jsonText.c_str(), jsonText.length());
+	}
+
+	template<typename T>
+	void Deserialize(T& t, const std::string& jsonText, const char* key)
+	{
+		Deserialize(t, jsonText.c_str(), jsonText.length(), key);
+	}
+
+	template<typename T>
+	void Deserialize(T& t, const char* jsonText, std::size_t length)
+	{
+		if (!TryDeserialize(t, jsonText, length))
+			KAPOK_THROW(std::invalid_argument(m_error.message));
+	}
+
+	//read the value of the key in the root object, a null key means the first member.
+	template<typename T>
+	void Deserialize(T& t, const char* jsonText, std::size_t length, const char* key)
+	{
+		if (!TryDeserialize(t, jsonText, length, key))
+			KAPOK_THROW(std::invalid_argument(m_error.message));
+	}
+
+	template<typename T>
+	bool TryDeserialize(T& t, const std::string& jsonText)
+	{
+		return TryDeserialize(t, jsonText.c_str(), jsonText.length());
+	}
+
+	template<typename T>
+	bool TryDeserialize(T& t, const std::string& jsonText, const char* key)
+	{
+		return TryDeserialize(t, jsonText.c_str(), jsonText.length(), key);
+	}
+
+	//like the SaxDeSerializer, the error has the code, the message and the offset but no path.
+	template<typename T>
+	bool TryDeserialize(T& t, const char* jsonText, std::size_t length)
+	{
+		Begin(jsonText, length);
+		const char* p = ProjectValue(t, SkipSpace(m_begin));
+		return p != nullptr && End(p);
+	}
+
+	template<typename T>
+	bool TryDeserialize(T& t, const char* jsonText, std::size_t length, const char* key)
+	{
+		Begin(jsonText, length);
+		const char* p = SkipSpace(m_begin);
+		if (p == m_end || *p != '{')
+			return Fail(ErrorCode::key_not_found, "the key is not exist", p);
+
+		bool found = false;
+		p = ProjectMembers(p, [this, &t, key, &found](const char* name, size_t len, const char* value) -> const char*
+		{
+			if (found || (key != nullptr && (len != std::strlen(key) || std::memcmp(name, key, len) != 0)))
+				return SkipValue(value);
+
+			found = true;
+			return ProjectValue(t, value);
+		});
+
+		if (p == nullptr || !End(p))
+			return false;
+
+		return found || Fail(ErrorCode::key_not_found, "the key is not exist", p);
+	}
+
+	const Error& GetError() const
+	{
+		return m_error;
+	}
+
+private:
+	void Begin(const char* jsonText, std::size_t length)
+	{
+		m_error.Clear();
+		m_pending.clear();
+		m_begin = jsonText;
+		m_end = jsonText + length;
+	}
+
+	//the text after the root value may only be spaces, then the wanted values are read.
+	bool End(const char* p)
+	{
+		if (SkipSpace(p) != m_end)
+		{
+			Fail(rapidjson::kParseErrorDocumentRootNotSingular, p);
+			return false;
+		}
+
+		size_t size = 0;
+		for (auto& pending : m_pending)
+			size += pending.length;
+
+		m_text.resize(size);
+		char* text = m_text.data();
+		for (auto& pending : m_pending)
+		{
+			std::memcpy(text, m_begin + pending.offset, pending.length);
+			if (!pending.read(*this, pending.obj, text, pending.length))
+			{
+				const Error& error = m_sax.GetError();
+				m_error.Set(error.code, error.message, pending.offset + (error.offset == Error::npos ? 0 : error.offset));
+				return false;
+			}
+
+			text += pending.length;
+		}
+
+		return true;
+	}
+
+	bool Fail(ErrorCode code, const char* message, const char* p)
+	{
+		m_error.Set(code, message, static_cast<size_t>(p - m_begin));
+		return false;
+	}
+
+	//the walk returns null once the text is found broken at p.
+	const char* Fail(rapidjson::ParseErrorCode code, const char* p)
+	{
+		Fail(ErrorCode::parse_error, rapidjson::GetParseError_En(code), p);
+		return nullptr;
+	}
+
+	template<typename T>
+	auto ProjectValue(T& t, const char* p) -> std::enable_if_t<is_user_class<T>::value, const char*>
+	{
+		//null, an array or a scalar is left to the reader of the other values.
+		if (p == m_end || *p != '{')
+			return Read(t, p);
+
+		//a duplicate key is skipped, the field keeps the first value like the DeSerializer.
+		std::bitset<std::tuple_size<decltype(t.Meta())>::value> read;
+		return ProjectMembers(p, [this, &t, &read](const char* name, size_t length, const char* value) -> const char*
+		{
+			size_t index = FieldIndex(t, name, length, std::integral_constant<bool, detail::has_meta_names<T>::value>{});
+			if (index == npos || read.test(index))
+				return SkipValue(value);
+
+			read.set(index);
+			return ProjectField(t.Meta(), index, value, std::make_index_sequence<std::tuple_size<decltype(t.Meta())>::value>{});
+		});
+	}
+
+	template<typename T>
+	auto ProjectValue(T& t, const char* p) -> std::enable_if_t<!is_user_class<T>::value, const char*>
+	{
+		return Read(t, p);
+	}
+
+	template<typename T>
+	const char* Read(T& t, const char* p)
+	{
+		const char* end = SkipValue(p);
+		if (end != nullptr)
+			m_pending.push_back(Pending{ &ReadPending<T>, &t, static_cast<size_t>(p - m_begin), static_cast<size_t>(end - p) });
+
+		return end;
+	}
+
+	template<typename T>
+	static bool ReadPending(ProjectionDeSerializer& dr, void* obj, char* text, size_t length)
+	{
+		return dr.m_sax.TryDeserializeInsitu(*static_cast<T*>(obj), text, length);
+	}
+
+	//the field of the member is picked by index from a table.
+	template<typename Tuple, size_t... Is>
+	const char* ProjectField(Tuple&& tp, size_t index, const char* p, std::index_sequence<Is...>)
+	{
+		using tuple_t = std::remove_reference_t<Tuple>;
+		using projector_t = const char*(*)(ProjectionDeSerializer&, tuple_t&, const char*);
+		static const projector_t projectors[] = { &ProjectFieldAt<Is, tuple_t>... };
+		return projectors[index](*this, tp, p);
+	}
+
+	template<size_t I, typename Tuple>
+	static const char* ProjectFieldAt(ProjectionDeSerializer& dr, Tuple& tp, const char* p)
+	{
+		return dr.ProjectValue(std::get<I>(tp).second, p);
+	}
+
+	template<typename T>
+	static size_t FieldIndex(T&, const char* key, size_t length, std::true_type)
+	{
+		return field_table<T>::find(key, length);
+	}
+
+	template<typename T>
+	static size_t FieldIndex(T& t, const char* key, size_t length, std::false_type)
+	{
+		auto tp = t.Meta();
+		const size_t size = std::tuple_size<decltype(tp)>::value;
+		return FieldIndex(tp, key, length, std::make_index_sequence<size>{});
+	}
+
+	template<typename Tuple, size_t... Is>
+	static size_t FieldIndex(const Tuple& tp, const char* key, size_t length, std::index_sequence<Is...>)
+	{
+		const char* names[] = { std::get<Is>(tp).first... };
+		for (size_t i = 0; i < sizeof...(Is); i++)
+		{
+			if (std::strlen(names[i]) == length && std::memcmp(names[i], key, length) == 0)
+				return i;
+		}
+
+		return npos;
+	}
+
+	//p is at the '{' of an object, member(name, length, value) returns the end of the value or null
+	//on an error. The result is the end of the object.
+	template<typename Member>
+	const char* ProjectMembers(const char* p, Member member)
+	{
+		p = SkipSpace(p + 1);
+		if (p != m_end && *p == '}')
+			return p + 1;
+
+		for (;;)
+		{
+			if (p == m_end || *p != '"')
+				return Fail(rapidjson::kParseErrorObjectMissName, p);
+
+			const char* name = p + 1;
+			const char* end = SkipString(name);
+			if (end == nullptr)
+				return Fail(rapidjson::kParseErrorStringMissQuotationMark, p);
+
+			size_t length = static_cast<size_t>(end - 1 - name);
+			if (std::memchr(name, '\\', length) != nullptr)
+			{
+				if (!Unescape(p, end))
+					return nullptr;
+
+				name = m_key.data();
+				length = m_key.size();
+			}
+
+			p = SkipSpace(end);
+			if (p == m_end || *p != ':')
+				return Fail(rapidjson::kParseErrorObjectMissColon, p);
+
+			p = member(name, length, SkipSpace(p + 1));
+			if (p == nullptr)
+				return nullptr;
+
+			p = SkipSpace(p);
+			if (p != m_end && *p == ',')
+			{
+				p = SkipSpace(p + 1);
+				continue;
+			}
+
+			if (p != m_end && *p == '}')
+				return p + 1;
+
+			return Fail(rapidjson::kParseErrorObjectMissCommaOrCurlyBracket, p);
+		}
+	}
+
+	//a name with escapes is decoded by the reader into m_key, it is rare enough.
+	bool Unescape(const char* begin, const char* end)
+	{
+		struct KeyHandler : rapidjson::BaseReaderHandler<rapidjson::UTF8<>, KeyHandler>
+		{
+			std::string& key;
+
+			explicit KeyHandler(std::string& k) : key(k)
+			{
+			}
+
+			bool String(const char* str, rapidjson::SizeType length, bool)
+			{
+				key.assign(str, length);
+				return true;
+			}
+		};
+
+		KeyHandler handler(m_key);
+		rapidjson::MemoryStream ms(begin, static_cast<size_t>(end - begin));
+		rapidjson::ParseResult r = m_reader.Parse(ms, handler);
+		if (!r.IsError())
+			return true;
+
+		Fail(r.Code(), begin + r.Offset());
+		return false;
+	}
+
+	const char* SkipSpace(const char* p) const
+	{
+		while (p != m_end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+			++p;
+
+		return p;
+	}
+
+	//p is after the opening quote, the result is after the closing one.
+	const char* SkipString(const char* p) const
+	{
+		for (; p != m_end; ++p)
+		{
+			if (*p == '"')
+				return p + 1;
+
+			if (*p == '\\' && ++p == m_end)
+				break;
+		}
+
+		return nullptr;
+	}
+
+	//only the brackets and the quotes are matched, the rest of the value is not looked at.
+	const char* SkipValue(const char* p)
+	{
+		const char* value = p;
+		if (p == m_end)
+			return Fail(rapidjson::kParseErrorValueInvalid, p);
+
+		if (*p == '"')
+		{
+			p = SkipString(p + 1);
+			return p != nullptr ? p : Fail(rapidjson::kParseErrorStringMissQuotationMark, value);
+		}
+
+		if (*p != '{' && *p != '[')
+		{
+			while (p != m_end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t')
+				++p;
+
+			return p != value ? p : Fail(rapidjson::kParseErrorValueInvalid, p);
+		}
+
+		size_t depth = 0;
+		for (; p != m_end; ++p)
+		{
+			switch (*p)
+			{
+			case '"':
+				p = SkipString(p + 1);
+				if (p == nullptr)
+					return Fail(rapidjson::kParseErrorStringMissQuotationMark, value);
+
+				--p;
+				break;
+			case '{':
+			case '[':
+				++depth;
+				break;
+			case '}':
+			case ']':
+				if (--depth == 0)
+					return p + 1;
+
+				break;
+			default:
+				break;
+			}
+		}
+
+		return Fail(value[0] == '{' ? rapidjson::kParseErrorObjectMissCommaOrCurlyBracket : rapidjson::kParseErrorArrayMissCommaOrSquareBracket, p);
+	}
+
+private:
+	SaxDeSerializer m_sax;
+	rapidjson::Reader m_reader;
+	std::vector<Pending> m_pending;
+	std::vector<char> m_text;
+	std::string m_key;
+	const char* m_begin = nullptr;
+	const char* m_end = nullptr;
+	Error m_error;
+};
+} // namespace kapok
@@ -0,0 +1,1066 @@
+#pragma once
+#include <cstring>
+#include <algorithm>
+#include <deque>
+#include "JsonUtil.hpp"
+#include "traits.hpp"
+#include "PerfectHash.hpp"
+#include "rapidjson/reader.h"
+#include "KeyCast.hpp"
+#include "NumberParse.hpp"
+#include "VariantAccess.hpp"
+#include "Error.hpp"
+#include "rapidjson/error/en.h"
+
+namespace kapok {
+// Single pass deserializer built on rapidjson::Reader. The reader events are written straight
+// into the target object, no rapidjson::Document is built. Every nested object/array being
+// filled is tracked by a frame on m_frames, which keeps its capacity between messages.
+class SaxDeSerializer : NonCopyable
+{
+	enum class EventType
+	{
+		Scalar,
+		Key,
+		StartObject,
+		StartArray,
+		End
+	};
+
+	struct Event
+	{
+		explicit Event(EventType t) : type(t)
+		{
+		}
+
+		EventType type;
+		rapidjson::Value value; //the scalar or the key, strings are referenced, not copied.
+		const char* number = nullptr; //the text of a double, for the float targets.
+		size_t number_length = 0;
+	};
+
+	static const size_t npos = static_cast<size_t>(-1);
+
+	struct Frame;
+	using FrameHandler = bool(*)(SaxDeSerializer&, Frame&, Event&);
+
+	struct Frame
+	{
+		FrameHandler handle;
+		void* obj;				//the object being filled.
+		void* cur;				//frame specific: current map value, pending element or root key.
+		size_t index;			//frame specific: current field/element index.
+		void(*release)(void*);	//releases cur when the frame is popped.
+		size_t fields = npos;	//user class: the first word of its read fields in m_fields.
+	};
+
+	//the target of ForEach, the elements of the array are read one by one into t.
+	template<typename T, typename Callback>
+	struct ForEachArray
+	{
+		T& t;
+		Callback& callback;
+	};
+
+	struct Handler
+	{
+		SaxDeSerializer& dr;
+		const char* number = nullptr;
+		size_t number_length = 0;
+
+		bool Null()
+		{
+			Event e(EventType::Scalar);
+			return dr.Dispatch(e);
+		}
+
+		bool Bool(bool b)
+		{
+			Event e(EventType::Scalar);
+			e.value.SetBool(b);
+			return dr.Dispatch(e);
+		}
+
+		bool Int(int i)
+		{
+			Event e(EventType::Scalar);
+			e.value.SetInt(i);
+			return dr.Dispatch(e);
+		}
+
+		bool Uint(unsigned u)
+		{
+			Event e(EventType::Scalar);
+			e.value.SetUint(u);
+			return dr.Dispatch(e);
+		}
+
+		bool Int64(int64_t i)
+		{
+			Event e(EventType::Scalar);
+			e.value.SetInt64(i);
+			return dr.Dispatch(e);
+		}
+
+		bool Uint64(uint64_t u)
+		{
+			Event e(EventType::Scalar);
+			e.value.SetUint64(u);
+			return dr.Dispatch(e);
+		}
+
+		bool Double(double d)
+		{
+			Event e(EventType::Scalar);
+			e.value.SetDouble(d);
+			e.number = number;
+			e.number_length = number_length;
+			return dr.Dispatch(e);
+		}
+
+		//the reader runs with kParseNumberFlags, the doubles are correctly rounded.
+		bool RawNumber(const char* str, rapidjson::SizeType length, bool)
+		{
+			number = str;
+			number_length = length;
+			return detail::parse_number(str, length, *this);
+		}
+
+		bool String(const char* str, rapidjson::SizeType length, bool)
+		{
+			Event e(EventType::Scalar);
+			e.value.SetString(rapidjson::StringRef(str, length));
+			return dr.Dispatch(e);
+		}
+
+		bool Key(const char* str, rapidjson::SizeType length, bool)
+		{
+			Event e(EventType::Key);
+			e.value.SetString(rapidjson::StringRef(str, length));
+			return dr.Dispatch(e);
+		}
+
+		bool StartObject()
+		{
+			Event e(EventType::StartObject);
+			return dr.Dispatch(e);
+		}
+
+		bool EndObject(rapidjson::SizeType)
+		{
+			return dr.End();
+		}
+
+		bool StartArray()
+		{
+			Event e(EventType::StartArray);
+			return dr.Dispatch(e);
+		}
+
+		bool EndArray(rapidjson::SizeType)
+		{
+			return dr.End();
+		}
+	};
+
+public:
+	SaxDeSerializer()
+	{
+		m_frames.reserve(16);
+	}
+
+	~SaxDeSerializer()
+	{
+		ClearFrames();
+	}
+
+	template<typename T>
+	void Deserialize(T& t, const std::string& jsonText)
+	{
+		Deserialize(t, jsonText.c_str(), jsonText.length());
+	}
+
+	template<typename T>
+	void Deserialize(T& t, const std::string& jsonText, const char* key)
+	{
+		Deserialize(t, jsonText.c_str(), jsonText.length(), key);
+	}
+
+	template<typename T>
+	void Deserialize(T& t, const char* jsonText, std::size_t length)
+	{
+		if (!TryDeserialize(t, jsonText, length))
+			KAPOK_THROW(std::invalid_argument(m_error.message));
+	}
+
+	//read the value of the key in the root object, a null key means the first member.
+	template<typename T>
+	void Deserialize(T& t, const char* jsonText, std::size_t length, const char* key)
+	{
+		if (!TryDeserialize(t, jsonText, length, key))
+			KAPOK_THROW(std::invalid_argument(m_error.message));
+	}
+
+	//the Try versions return false instead of throwing, GetError then holds the code, the message
+	//and the byte offset where the reader stopped. The values are written as they are read, so
+	//the path of the failed value is not tracked here, the offset points at it.
+	template<typename T>
+	bool TryDeserialize(T& t, const std::string& jsonText)
+	{
+		return TryDeserialize(t, jsonText.c_str(), jsonText.length());
+	}
+
+	template<typename T>
+	bool TryDeserialize(T& t, const std::string& jsonText, const char* key)
+	{
+		return TryDeserialize(t, jsonText.c_str(), jsonText.length(), key);
+	}
+
+	template<typename T>
+	bool TryDeserialize(T& t, const char* jsonText, std::size_t length)
+	{
+		return Parse(jsonText, length, Frame{ &RootFrame<T>, &t, nullptr, 0, nullptr });
+	}
+
+	template<typename T>
+	bool TryDeserialize(T& t, const char* jsonText, std::size_t length, const char* key)
+	{
+		m_found = false;
+		if (!Parse(jsonText, length, Frame{ &KeyRootFrame<T>, &t, (void*)key, 0, nullptr }))
+			return false;
+
+		if (!m_found)
+			m_error.Set(ErrorCode::key_not_found, "the key is not exist");
+
+		return m_found;
+	}
+
+	//reads the caller's buffer in place without copying it, the buffer is modified and the
+	//boost::string_ref/std::string_view members point into it. The buffer must outlive them.
+	template<typename T>
+	void DeserializeInsitu(T& t, char* jsonText, std::size_t length)
+	{
+		if (!TryDeserializeInsitu(t, jsonText, length))
+			KAPOK_THROW(std::invalid_argument(m_error.message));
+	}
+
+	template<typename T>
+	bool TryDeserializeInsitu(T& t, char* jsonText, std::size_t length)
+	{
+		detail::InsituBufferStream is(jsonText, length);
+		return Parse<rapidjson::kParseInsituFlag>(is, Frame{ &RootFrame<T>, &t, nullptr, 0, nullptr });
+	}
+
+	//reads a json array of any size from a rapidjson input stream (FileReadStream, IStreamWrapper...)
+	//one element at a time: each element is read into the same T and handed to callback(T&), the
+	//memory used does not depend on the length of the array. The containers and the strings of T
+	//are cleared between the elements, so their capacity is reused. The views of T point into copies
+	//of their strings, valid in the callback.
+	template<typename T, typename InputStream, typename Callback>
+	void ForEach(InputStream& is, Callback callback)
+	{
+		if (!TryForEach<T>(is, callback))
+			KAPOK_THROW(std::invalid_argument(m_error.message));
+	}
+
+	//the array is the value of the key in the root object, a null key means the first member.
+	template<typename T, typename InputStream, typename Callback>
+	void ForEach(InputStream& is, const char* key, Callback callback)
+	{
+		if (!TryForEach<T>(is, key, callback))
+			KAPOK_THROW(std::invalid_argument(m_error.message));
+	}
+
+	template<typename T, typename InputStream, typename Callback>
+	bool TryForEach(InputStream& is, Callback callback)
+	{
+		T t{};
+		ForEachArray<T, Callback> array{ t, callback };
+		return Parse<0>(is, Frame{ &RootFrame<ForEachArray<T, Callback>>, &array, nullptr, 0, nullptr });
+	}
+
+	template<typename T, typename InputStream, typename Callback>
+	bool TryForEach(InputStream& is, const char* key, Callback callback)
+	{
+		T t{};
+		ForEachArray<T, Callback> array{ t, callback };
+		m_found = false;
+		if (!Parse<0>(is, Frame{ &KeyRootFrame<ForEachArray<T, Callback>>, &array, (void*)key, 0, nullptr }))
+			return false;
+
+		if (!m_found)
+			m_error.Set(ErrorCode::key_not_found, "the key is not exist");
+
+		return m_found;
+	}
+
+	const Error& GetError() const
+	{
+		return m_error;
+	}
+
+	//once a message grew the copy of the json text over threshold bytes, the next Deserialize
+	//shrinks it to size bytes first.
+	void SetTrimPolicy(size_t threshold, size_t size)
+	{
+		m_text.SetTrimPolicy(threshold, size);
+	}
+
+	//shrinks the copy of the json text now.
+	void Trim()
+	{
+		m_text.Trim();
+	}
+
+	template<typename T>
+	T Deserialize(const char* jsonText, std::size_t length)
+	{
+		T t{};
+		Deserialize(t, jsonText, length);
+		return t;
+	}
+
+private:
+	//parsed in place on a copy, the reader hands the numbers over without copying them and the
+	//views point into the copy until the next parse.
+	bool Parse(const char* jsonText, std::size_t length, Frame root)
+	{
+		detail::InsituBufferStream is(m_text.Assign(jsonText, length), length);
+		return Parse<rapidjson::kParseInsituFlag>(is, root);
+	}
+
+	template<unsigned parseFlags, typename InputStream>
+	bool Parse(InputStream& is, Frame root)
+	{
+		m_copy_views = (parseFlags & rapidjson::kParseInsituFlag) == 0;
+		m_view_count = 0;
+		ClearFrames();
+		m_error.Clear();
+		m_frames.push_back(root);
+
+		Handler handler{ *this };
+		rapidjson::ParseResult r = detail::ParseRawNumbers<parseFlags>(m_reader, is, handler);
+		ClearFrames();
+		if (!r.IsError())
+			return true;
+
+		//a handler failure keeps its own code, the reader only knows where it stopped.
+		m_error.Set(ErrorCode::parse_error, rapidjson::GetParseError_En(r.Code()));
+		m_error.offset = r.Offset();
+		return false;
+	}
+
+	bool Dispatch(Event& e)
+	{
+		Frame& f = m_frames.back();
+		return f.handle(*this, f, e);
+	}
+
+	bool End()
+	{
+		Event e(EventType::End);
+		bool r = Dispatch(e);
+		PopFrame();
+		return r;
+	}
+
+	void PopFrame()
+	{
+		Frame& f = m_frames.back();
+		if (f.release != nullptr && f.cur != nullptr)
+			f.release(f.cur);
+
+		if (f.fields != npos)
+			m_fields.resize(f.fields);
+
+		m_frames.pop_back();
+	}
+
+	void ClearFrames()
+	{
+		while (!m_frames.empty())
+			PopFrame();
+	}
+
+	bool Fail(ErrorCode code, const char* message)
+	{
+		m_error.Set(code, message);
+		return false;
+	}
+
+	//a frame is pushed only after the expected start event, the frame handler must not touch its frame afterwards.
+	template<typename T>
+	bool Begin(T& t, Event& e, EventType expected, FrameHandler handle, size_t index = 0)
+	{
+		if (e.type == expected)
+		{
+			m_frames.push_back(Frame{ handle, &t, nullptr, index, nullptr });
+			return true;
+		}
+
+		if (e.type == EventType::Scalar && e.value.IsNull())
+			return true;
+
+		return Fail(ErrorCode::type_mismatch, expected == EventType::StartObject ? "should be object" : "should be array");
+	}
+
+	bool Skip(Event& e)
+	{
+		if (e.type == EventType::StartObject || e.type == EventType::StartArray)
+			m_frames.push_back(Frame{ &SkipFrame, nullptr, nullptr, 0, nullptr });
+
+		return true;
+	}
+
+	template<typename T>
+	auto ReadValue(T& t, Event& e) -> std::enable_if_t<is_basic_type<T>::value, bool>
+	{
+		if (e.type != EventType::Scalar)
+			return Skip(e);
+
+		JsonUtil::ReadValue(t, e.value);
+		return true;
+	}
+
+	//the float nearest to the number text, not the double rounded once more.
+	bool ReadValue(float& t, Event& e)
+	{
+		if (e.type != EventType::Scalar)
+			return Skip(e);
+
+		if (!e.value.IsNumber())
+			return true;
+
+		if (e.value.IsDouble())
+			t = e.number != nullptr ? detail::to_float(e.value.GetDouble(), e.number, e.number_length) : static_cast<float>(e.value.GetDouble());
+		else
+			t = e.value.IsInt64() ? static_cast<float>(e.value.GetInt64()) : static_cast<float>(e.value.GetUint64());
+
+		return true;
+	}
+
+	template<typename T>
+	auto ReadValue(T& t, Event& e) -> std::enable_if_t<std::is_enum<T>::value, bool>
+	{
+		using under_type = std::underlying_type_t<T>;
+		return ReadValue(reinterpret_cast<under_type&>(t), e);
+	}
+
+	template<typename T>
+	auto ReadValue(T& t, Event& e) -> std::enable_if_t<is_optional<T>::value, bool>
+	{
+		if (e.type == EventType::Scalar && e.value.IsNull())
+			return true;
+
+		t.emplace();
+		return ReadValue(*t, e);
+	}
+
+	//the object keeps one bit per field in m_fields, set once the field is read.
+	template<typename T>
+	auto ReadValue(T& t, Event& e) -> std::enable_if_t<is_user_class<T>::value, bool>
+	{
+		if (e.type != EventType::StartObject)
+			return Begin(t, e, EventType::StartObject, &UserClassFrame<T>);
+
+		using tuple_t = decltype(t.Meta());
+		m_frames.push_back(Frame{ &UserClassFrame<T>, &t, nullptr, 0, nullptr, m_fields.size() });
+		m_fields.resize(m_fields.size() + (std::tuple_size<tuple_t>::value + 63) / 64);
+		return true;
+	}
+
+	//marks the field of the frame read, false if it already was.
+	bool FirstRead(const Frame& f, size_t index)
+	{
+		uint64_t& word = m_fields[f.fields + index / 64];
+		const uint64_t bit = uint64_t(1) << (index % 64);
+		if ((word & bit) != 0)
+			return false;
+
+		word |= bit;
+		return true;
+	}
+
+	template<typename T>
+	auto ReadValue(T& t, Event& e) -> std::enable_if_t<is_map_container<T>::value, bool>
+	{
+		return Begin(t, e, EventType::StartObject, &MapFrame<T>);
+	}
+
+	template<typename T>
+	auto ReadValue(T& t, Event& e) -> std::enable_if_t<is_pair<T>::value, bool>
+	{
+		return Begin(t, e, EventType::StartObject, &PairFrame<T>);
+	}
+
+	template<typename T>
+	auto ReadValue(T& t, Event& e) -> std::enable_if_t<is_variant<T>::value, bool>
+	{
+		return Begin(t, e, EventType::StartObject, &VariantFrame<T>);
+	}
+
+	template<typename T>
+	auto ReadValue(T& t, Event& e) -> std::enable_if_t<is_tuple<T>::value, bool>
+	{
+		return Begin(t, e, EventType::StartArray, &TupleFrame<T>);
+	}
+
+	template<typename T>
+	auto ReadValue(T& t, Event& e) -> std::enable_if_t<std::is_array<T>::value || is_std_array<T>::value, bool>
+	{
+		return Begin(t, e, EventType::StartArray, &ArrayFrame<T>);
+	}
+
+	template<typename T>
+	auto ReadValue(T& t, Event& e) -> std::enable_if_t<is_singlevalue_container<T>::value, bool>
+	{
+		return Begin(t, e, EventType::StartArray, &ContainerFrame<T>);
+	}
+
+	template<typename T>
+	auto ReadValue(T& t, Event& e) -> std::enable_if_t<is_container_adapter<T>::value || is_stack<T>::value, bool>
+	{
+		//remember where the new elements start, stack needs to reverse them at the end.
+		return Begin(t, e, EventType::StartArray, &AdaptorFrame<T>, detail::adaptor_access<T>::container(t).size());
+	}
+
+	template<typename T, typename Callback>
+	bool ReadValue(ForEachArray<T, Callback>& array, Event& e)
+	{
+		return Begin(array, e, EventType::StartArray, &ForEachFrame<T, Callback>);
+	}
+
+	//the strings of a parse which is not in place only live on the reader's stack: a view gets a
+	//copy of its string, valid until the next parse (or the next element of a ForEach).
+	const char* KeepString(const char* str, size_t length)
+	{
+		if (!m_copy_views)
+			return str;
+
+		if (m_view_count == m_views.size())
+			m_views.emplace_back();
+
+		std::string& copy = m_views[m_view_count++];
+		copy.assign(str, length);
+		return copy.data();
+	}
+
+	template<typename View>
+	bool ReadView(View& t, Event& e)
+	{
+		if (e.type != EventType::Scalar)
+			return Skip(e);
+
+		if (e.value.IsString())
+			t = View(KeepString(e.value.GetString(), e.value.GetStringLength()), e.value.GetStringLength());
+
+		return true;
+	}
+
+	bool ReadValue(boost::string_ref& t, Event& e)
+	{
+		return ReadView(t, e);
+	}
+
+	bool ToKey(const rapidjson::Value& name, boost::string_ref& key)
+	{
+		key = boost::string_ref(KeepString(name.GetString(), name.GetStringLength()), name.GetStringLength());
+		return true;
+	}
+
+#ifdef KAPOK_HAS_STRING_VIEW
+	bool ReadValue(std::string_view& t, Event& e)
+	{
+		return ReadView(t, e);
+	}
+
+	bool ToKey(const rapidjson::Value& name, std::string_view& key)
+	{
+		key = std::string_view(KeepString(name.GetString(), name.GetStringLength()), name.GetStringLength());
+		return true;
+	}
+#endif
+
+	template<typename T>
+	bool ToKey(const rapidjson::Value& name, T& key)
+	{
+		const char* error = detail::key_cast(name.GetString(), name.GetStringLength(), key);
+		return error == nullptr || Fail(ErrorCode::bad_key, error);
+	}
+
+	template<typename It>
+	static It ToIterator(It it)
+	{
+		return it;
+	}
+
+	template<typename It>
+	static It ToIterator(std::pair<It, bool> r)
+	{
+		return r.first;
+	}
+
+	template<typename It>
+	static bool Inserted(It)
+	{
+		return true;
+	}
+
+	template<typename It>
+	static bool Inserted(std::pair<It, bool> r)
+	{
+		return r.second;
+	}
+
+	template<typename T>
+	static void Release(void* p)
+	{
+		delete static_cast<T*>(p);
+	}
+
+	static bool SkipFrame(SaxDeSerializer& dr, Frame&, Event& e)
+	{
+		return dr.Skip(e);
+	}
+
+	template<typename T>
+	static bool RootFrame(SaxDeSerializer& dr, Frame& f, Event& e)
+	{
+		return dr.ReadValue(*static_cast<T*>(f.obj), e);
+	}
+
+	template<typename T>
+	static bool KeyRootFrame(SaxDeSerializer& dr, Frame& f, Event& e)
+	{
+		if (e.type != EventType::StartObject)
+			return dr.Fail(ErrorCode::key_not_found, "the key is not exist");
+
+		dr.m_frames.push_back(Frame{ &KeyObjectFrame<T>, f.obj, f.cur, 0, nullptr });
+		return true;
+	}
+
+	//the root object, only the value of the key is read, a null key means the first member. A
+	//repeated key is skipped once read, the first one is kept as by the DeSerializer.
+	template<typename T>
+	static bool KeyObjectFrame(SaxDeSerializer& dr, Frame& f, Event& e)
+	{
+		const char* key = static_cast<const char*>(f.cur);
+		switch (e.type)
+		{
+		case EventType::Key:
+			f.index = !dr.m_found && (key == nullptr || (e.value.GetStringLength() == std::strlen(key)
+				&& std::memcmp(e.value.GetString(), key, e.value.GetStringLength()) == 0));
+			return true;
+		case EventType::End:
+			return true;
+		default:
+			if (f.index == 0)
+				return dr.Skip(e);
+
+			dr.m_found = true;
+			return dr.ReadValue(*static_cast<T*>(f.obj), e);
+		}
+	}
+
+	template<typename T>
+	static bool UserClassFrame(SaxDeSerializer& dr, Frame& f, Event& e)
+	{
+		T& t = *static_cast<T*>(f.obj);
+		switch (e.type)
+		{
+		case EventType::Key:
+			f.index = FieldIndex(t, e.value.GetString(), e.value.GetStringLength(),
+				std::integral_constant<bool, detail::has_meta_names<T>::value>{});
+
+			//the value of a duplicate key is skipped, the first one is kept as by the DeSerializer.
+			if (f.index != npos && !dr.FirstRead(f, f.index))
+				f.index = npos;
+
+			return true;
+		case EventType::End:
+			return true;
+		default:
+			if (f.index == npos)
+				return dr.Skip(e);
+
+			return dr.ReadField(t.Meta(), f.index, e);
+		}
+	}
+
+	template<typename T>
+	static size_t FieldIndex(T&, const char* key, size_t length, std::true_type)
+	{
+		return field_table<T>::find(key, length);
+	}
+
+	template<typename T>
+	static size_t FieldIndex(T& t, const char* key, size_t length, std::false_type)
+	{
+		auto tp = t.Meta();
+		return FieldIndex(tp, key, length, std::make_index_sequence<std::tuple_size<decltype(tp)>::value>{});
+	}
+
+	template<typename Tuple, size_t... Is>
+	static size_t FieldIndex(const Tuple& tp, const char* key, size_t length, std::index_sequence<Is...>)
+	{
+		const char* names[] = { std::get<Is>(tp).first... };
+		for (size_t i = 0; i < sizeof...(Is); i++)
+		{
+			if (std::strlen(names[i]) == length && std::memcmp(names[i], key, length) == 0)
+				return i;
+		}
+
+		return npos;
+	}
+
+	template<typename Tuple>
+	bool ReadField(Tuple&& tp, size_t index, Event& e)
+	{
+		using tuple_t = std::remove_reference_t<Tuple>;
+		return ReadField(tp, index, e, std::make_index_sequence<std::tuple_size<tuple_t>::value>{});
+	}
+
+	template<typename Tuple, size_t... Is>
+	bool ReadField(Tuple& tp, size_t index, Event& e, std::index_sequence<Is...>)
+	{
+		using reader_t = bool(*)(SaxDeSerializer&, Tuple&, Event&);
+		static const reader_t readers[] = { &ReadFieldAt<Is, Tuple>... };
+		return readers[index](*this, tp, e);
+	}
+
+	template<size_t I, typename Tuple>
+	static bool ReadFieldAt(SaxDeSerializer& dr, Tuple& tp, Event& e)
+	{
+		return dr.ReadValue(std::get<I>(tp).second, e);
+	}
+
+	template<typename T>
+	static bool TupleFrame(SaxDeSerializer& dr, Frame& f, Event& e)
+	{
+		if (e.type == EventType::End)
+			return true;
+
+		if (f.index >= std::tuple_size<T>::value)
+			return dr.Skip(e);
+
+		size_t index = f.index++;
+		return dr.ReadElement(*static_cast<T*>(f.obj), index, e, std::make_index_sequence<std::tuple_size<T>::value>{});
+	}
+
+	template<typename Tuple, size_t... Is>
+	bool ReadElement(Tuple& tp, size_t index, Event& e, std::index_sequence<Is...>)
+	{
+		using reader_t = bool(*)(SaxDeSerializer&, Tuple&, Event&);
+		static const reader_t readers[] = { &ReadElementAt<Is, Tuple>... };
+		return readers[index](*this, tp, e);
+	}
+
+	template<size_t I, typename Tuple>
+	static bool ReadElementAt(SaxDeSerializer& dr, Tuple& tp, Event& e)
+	{
+		return dr.ReadValue(std::get<I>(tp), e);
+	}
+
+	template<typename T>
+	static bool ArrayFrame(SaxDeSerializer& dr, Frame& f, Event& e)
+	{
+		T& t = *static_cast<T*>(f.obj);
+		if (e.type == EventType::End)
+			return true;
+
+		if (f.index >= sizeof(t) / sizeof(t[0]))
+			return dr.Skip(e);
+
+		size_t index = f.index++;
+		return dr.ReadValue(t[index], e);
+	}
+
+	template<typename T>
+	using is_back_insertable = std::integral_constant<bool, !is_set<T>::value && !is_multiset<T>::value
+		&& !is_unordered_set<T>::value && !std::is_same<typename T::value_type, bool>::value>;
+
+	template<typename T>
+	static auto ContainerFrame(SaxDeSerializer& dr, Frame& f, Event& e) -> std::enable_if_t<is_back_insertable<T>::value, bool>
+	{
+		if (e.type == EventType::End)
+			return true;
+
+		T& t = *static_cast<T*>(f.obj);
+		t.emplace_back();
+		return dr.ReadValue(t.back(), e);
+	}
+
+	//set like containers: a nested element is read into a pending element owned by the frame,
+	//and it is inserted when the next element or the end of the array arrives.
+	template<typename T>
+	static auto ContainerFrame(SaxDeSerializer& dr, Frame& f, Event& e) -> std::enable_if_t<!is_back_insertable<T>::value, bool>
+	{
+		using value_type = typename T::value_type;
+		T& t = *static_cast<T*>(f.obj);
+		value_type* pending = static_cast<value_type*>(f.cur);
+		if (f.index != 0)
+		{
+			Insert(t, std::move(*pending));
+			f.index = 0;
+		}
+
+		if (e.type == EventType::End)
+			return true;
+
+		if (e.type == EventType::Scalar)
+		{
+			value_type value{};
+			if (!dr.ReadValue(value, e))
+				return false;
+
+			Insert(t, std::move(value));
+			return true;
+		}
+
+		if (pending == nullptr)
+		{
+			pending = new value_type();
+			f.cur = pending;
+			f.release = &Release<value_type>;
+		}
+		else
+		{
+			*pending = value_type();
+		}
+
+		f.index = 1;
+		return dr.ReadValue(*pending, e);
+	}
+
+	template<typename T, typename value_type>
+	static auto Insert(T& t, value_type&& v) -> std::enable_if_t<is_set<T>::value || is_multiset<T>::value || is_unordered_set<T>::value>
+	{
+		t.insert(std::move(v));
+	}
+
+	template<typename T, typename value_type>
+	static auto Insert(T& t, value_type&& v) -> std::enable_if_t<!is_set<T>::value && !is_multiset<T>::value && !is_unordered_set<T>::value>
+	{
+		t.push_back(std::move(v));
+	}
+
+	template<typename T>
+	static bool AdaptorFrame(SaxDeSerializer& dr, Frame& f, Event& e)
+	{
+		T& t = *static_cast<T*>(f.obj);
+		auto& c = detail::adaptor_access<T>::container(t);
+		if (e.type == EventType::End)
+		{
+			FinishAdaptor(t, c, f.index);
+			return true;
+		}
+
+		c.emplace_back();
+		return dr.ReadValue(c.back(), e);
+	}
+
+	template<typename T, typename Container>
+	static auto FinishAdaptor(T&, Container& c, size_t first) -> std::enable_if_t<is_stack<T>::value>
+	{
+		//the top of the stack is written first.
+		std::reverse(c.begin() + first, c.end());
+	}
+
+	template<typename T, typename Container>
+	static auto FinishAdaptor(T& t, Container& c, size_t) -> std::enable_if_t<is_priority_queue<T>::value>
+	{
+		//the json written by the serializer is in heap order already.
+		auto& comp = detail::adaptor_access<T>::compare(t);
+		if (!std::is_heap(c.begin(), c.end(), comp))
+			std::make_heap(c.begin(), c.end(), comp);
+	}
+
+	template<typename T, typename Container>
+	static auto FinishAdaptor(T&, Container&, size_t) -> std::enable_if_t<is_queue<T>::value>
+	{
+	}
+
+	//f.index is 1 while an element is being read, it is handed over at the next event of the array,
+	//which is the start of the next element or the end.
+	template<typename T, typename Callback>
+	static bool ForEachFrame(SaxDeSerializer& dr, Frame& f, Event& e)
+	{
+		auto& array = *static_cast<ForEachArray<T, Callback>*>(f.obj);
+		if (f.index != 0)
+		{
+			array.callback(array.t);
+			dr.m_view_count = 0;
+		}
+
+		if (e.type == EventType::End)
+			return true;
+
+		Clear(array.t);
+		f.index = 1;
+		return dr.ReadValue(array.t, e);
+	}
+
+	//the element is read into the T of the previous one: the strings and the containers are
+	//cleared and keep their capacity, the other values are value-initialized.
+	template<typename T>
+	static auto Clear(T& t) -> std::enable_if_t<is_user_class<T>::value>
+	{
+		auto tp = t.Meta();
+		ClearFields(tp, std::make_index_sequence<std::tuple_size<decltype(tp)>::value>{});
+	}
+
+	template<typename Tuple, size_t... Is>
+	static void ClearFields(Tuple& tp, std::index_sequence<Is...>)
+	{
+		(void)std::initializer_list<int>{ (Clear(std::get<Is>(tp).second), 0)... };
+	}
+
+	static void Clear(std::string& t)
+	{
+		t.clear();
+	}
+
+	template<typename T>
+	static auto Clear(T& t) -> std::enable_if_t<is_container<T>::value && !std::is_array<T>::value && !is_std_array<T>::value>
+	{
+		t.clear();
+	}
+
+	template<typename T>
+	static auto Clear(T& t) -> std::enable_if_t<std::is_array<T>::value || is_std_array<T>::value>
+	{
+		for (auto& v : t)
+			Clear(v);
+	}
+
+	//the adaptors have no clear, their underlying container is cleared.
+	template<typename T>
+	static auto Clear(T& t) -> std::enable_if_t<is_container_adapter<T>::value || is_stack<T>::value>
+	{
+		detail::adaptor_access<T>::container(t).clear();
+	}
+
+	template<typename T>
+	static auto Clear(T& t) -> std::enable_if_t<!is_user_class<T>::value && !is_container<T>::value
+		&& !is_container_adapter<T>::value && !is_stack<T>::value && !std::is_array<T>::value
+		&& !std::is_same<T, std::string>::value>
+	{
+		t = T{};
+	}
+
+	template<typename T>
+	static bool MapFrame(SaxDeSerializer& dr, Frame& f, Event& e)
+	{
+		using key_type = typename T::key_type;
+		using mapped_type = typename T::mapped_type;
+		T& t = *static_cast<T*>(f.obj);
+		switch (e.type)
+		{
+		case EventType::Key:
+		{
+			key_type key{};
+			if (!dr.ToKey(e.value, key))
+				return false;
+
+			//the value of a duplicate key is skipped, the first one is kept as by the DeSerializer.
+			auto r = t.emplace(std::move(key), mapped_type());
+			f.cur = Inserted(r) ? &ToIterator(r)->second : nullptr;
+			return true;
+		}
+		case EventType::End:
+			return true;
+		default:
+			if (f.cur == nullptr)
+				return dr.Skip(e);
+
+			return dr.ReadValue(*static_cast<mapped_type*>(f.cur), e);
+		}
+	}
+
+	template<typename T>
+	static bool PairFrame(SaxDeSerializer& dr, Frame& f, Event& e)
+	{
+		T& t = *static_cast<T*>(f.obj);
+		switch (e.type)
+		{
+		case EventType::Key:
+			if (f.index++ != 0)
+				return dr.Fail(ErrorCode::member_count, "member count error");
+
+			return dr.ToKey(e.value, t.first);
+		case EventType::End:
+			return f.index == 1 ? true : dr.Fail(ErrorCode::member_count, "member count error");
+		default:
+			return dr.ReadValue(t.second, e);
+		}
+	}
+
+	//f.index keeps the variant index plus one once the key has been read.
+	template<typename T>
+	static bool VariantFrame(SaxDeSerializer& dr, Frame& f, Event& e)
+	{
+		const size_t size = detail::variant_access<T>::size;
+		switch (e.type)
+		{
+		case EventType::Key:
+		{
+			if (f.index != 0)
+				return dr.Fail(ErrorCode::member_count, "Should be an object with one member");
+
+			size_t index = 0;
+			if (detail::key_cast(e.value.GetString(), e.value.GetStringLength(), index) != nullptr || index >= size)
+				return dr.Fail(ErrorCode::variant_index, "Wrong variant types.");
+
+			f.index = index + 1;
+			return true;
+		}
+		case EventType::End:
+			return f.index != 0 ? true : dr.Fail(ErrorCode::member_count, "Should be an object with one member");
+		default:
+			return dr.ReadAlternative(*static_cast<T*>(f.obj), f.index - 1, e, std::make_index_sequence<size>{});
+		}
+	}
+
+	template<typename T, size_t... Is>
+	bool ReadAlternative(T& v, size_t index, Event& e, std::index_sequence<Is...>)
+	{
+		using reader_t = bool(*)(SaxDeSerializer&, T&, Event&);
+		static const reader_t readers[] = { &ReadAlternativeAt<Is, T>... };
+		return readers[index](*this, v, e);
+	}
+
+	template<size_t I, typename T>
+	static bool ReadAlternativeAt(SaxDeSerializer& dr, T& v, Event& e)
+	{
+		return dr.ReadValue(detail::variant_access<T>::template emplace<I>(v), e);
+	}
+
+private:
+	rapidjson::Reader m_reader;
+	detail::TextCopy m_text; //the copy of the text parsed in place.
+	std::deque<std::string> m_views; //the copies of the viewed strings, kept between the messages.
+	size_t m_view_count = 0;
+	bool m_copy_views = false;
+	std::vector<Frame> m_frames;
+	std::vector<uint64_t> m_fields; //the read fields of the user class frames, a bit per field.
+	Error m_error;
+	bool m_found = false;
+};
+} // namespace kapok
+
+namespace kapok {
+//reads a huge json array element by element from a rapidjson input stream, see SaxDeSerializer::ForEach.
+template<typename T, typename InputStream, typename Callback>
+void for_each(InputStream& is, const char* key, Callback callback)
+{
+	SaxDeSerializer dr;
+	dr.ForEach<T>(is, key, std::move(callback));
+}
+
+template<typename T, typename InputStream, typename Callback>
+void for_each(InputStream& is, Callback callback)
+{
+	SaxDeSerializer dr;
+	dr.ForEach<T>(is, std::move(callback));
+}
+} // namespace kapok
@@ -1,13 +1,20 @@
 #pragma once
 #include <typeinfo>
+#include <stdexcept>
 #ifndef _MSC_VER
 #include <cxxabi.h>
 #endif
 #include "traits.hpp"
 #include "Common.hpp"
 #include "JsonUtil.hpp"
-#include <boost/lexical_cast.hpp>
-#include <fmt/format.h>
+#include "KeyFragments.hpp"
+#include "JsonSink.hpp"
+#include "KeyCast.hpp"
+#include "VariantAccess.hpp"
+#include "Parallel.hpp"
+#include <iterator>
+#include <memory>
+#include <boost/utility/string_ref.hpp>
 
 namespace kapok {
 class Serializer : NonCopyable
@@ -27,6 +34,69 @@ public:
 		return m_jsutil.GetJsonText();
 	}
 
+	//the format of the doubles: kapok::shortest(the default), kapok::grisu2 or kapok::precision<N>,
+	//or any type with a static char* Write(double, char*) writing at most 32 bytes.
+	template<typename Format>
+	void SetDoubleFormat()
+	{
+		m_jsutil.SetDoubleFormat(&Format::Write);
+	}
+
+	//the json text and its length, valid until the next Serialize.
+	boost::string_ref GetView() const
+	{
+		return boost::string_ref(m_jsutil.GetJsonData(), m_jsutil.GetJsonLength());
+	}
+
+	//moves the json text out without a copy.
+	std::string Release()
+	{
+		return m_jsutil.ReleaseJson();
+	}
+
+	//once a json text grew the buffer over threshold bytes, the next Serialize shrinks it to size bytes.
+	//the slices of a parallel write are released once they are joined if they hold more than threshold bytes.
+	void SetTrimPolicy(size_t threshold, size_t size)
+	{
+		m_jsutil.SetTrimPolicy(threshold, size);
+		m_trim_threshold = threshold;
+	}
+
+	//drops the json text and shrinks the buffer to the size of the trim policy, the slices of the
+	//parallel writes are released.
+	void Trim()
+	{
+		m_jsutil.TrimJson();
+		std::vector<std::string>().swap(m_slices);
+	}
+
+	//the bytes of the buffer kept between the json texts.
+	size_t GetReservedBytes() const
+	{
+		size_t reserved = m_jsutil.GetReserved();
+		for (auto& slice : m_slices)
+			reserved += slice.capacity();
+
+		return reserved;
+	}
+
+	//the random-access containers of at least min_elements elements are written by threads workers
+	//(0 means one per core, 1 turns it off): each worker writes slices of the elements into buffers
+	//of their own, which are joined in order. The json text is the same as the one of one thread.
+	//With a sink (see Serialize to a std::ostream) the elements are written min_elements at a time,
+	//each round reaching the sink before the next one starts, so the slices stay bounded. The worker
+	//threads and their Serializers are created by the first container written in parallel and kept
+	//until the next SetParallel.
+	void SetParallel(size_t threads, size_t min_elements = parallel_min_elements)
+	{
+		m_threads = detail::thread_count(threads);
+		m_parallel_min = min_elements;
+		m_workers.reset();
+		m_pool.reset();
+	}
+
+	static const size_t parallel_min_elements = 10000;
+
 	//template<typename T>
 	//void Serialize(T const& t, const char* key = nullptr)
 	//{	
@@ -55,12 +125,76 @@ public:
 		}
 	}
 
+	//streaming versions, the json text is flushed to the sink every stream_buffer_size bytes,
+	//the memory used does not depend on the size of the json text. A failed write throws
+	//std::runtime_error, or returns false with KAPOK_NO_EXCEPTIONS.
+	template<typename T>
+	bool Serialize(const T& t, const char* key, int fd)
+	{
+		const char* error = nullptr;
+		return SerializeTo(t, key, FdSink{ fd, &error }, error);
+	}
+
+	template<typename T>
+	bool Serialize(const T& t, const char* key, std::ostream& os)
+	{
+		const char* error = nullptr;
+		return SerializeTo(t, key, OStreamSink{ &os, &error }, error);
+	}
+
+	template<typename T>
+	bool Serialize(const T& t, const char* key, FILE* fp)
+	{
+		const char* error = nullptr;
+		return SerializeTo(t, key, FileSink{ fp, &error }, error);
+	}
+
+	static const size_t stream_buffer_size = 64 * 1024;
+
+	//appends the json text to the buffer of the caller, written in place and without a copy.
+	//Buffer is std::string, std::vector<char> or any type with size, resize and operator[].
+	template<typename T, typename Buffer>
+	void SerializeAppend(const T& t, const char* key, Buffer& out)
+	{
+		AttachGuard guard{ m_jsutil };
+		m_jsutil.Attach(out);
+		if (key == nullptr)
+			WriteObject(t, std::true_type{});
+		else
+			SerializeImpl(t, key);
+	}
+
 private:
+	struct AttachGuard
+	{
+		JsonUtil& jsutil;
+		~AttachGuard() { jsutil.Detach(); }
+	};
+
+	//error is set by the sink.
+	template<typename T>
+	bool SerializeTo(const T& t, const char* key, JsonBuffer::Sink sink, const char*& error)
+	{
+		struct SinkGuard
+		{
+			JsonUtil& jsutil;
+			~SinkGuard() { jsutil.SetSink(nullptr, 0); }
+		} guard{ m_jsutil };
+
+		m_jsutil.SetSink(std::move(sink), stream_buffer_size);
+		Serialize(t, key);
+		m_jsutil.Flush();
+		if (error != nullptr)
+			KAPOK_THROW(std::runtime_error(error));
+
+		return error == nullptr;
+	}
+
 	template<typename T>
 	void SerializeImpl(T const& t, const char* key)
 	{
 		m_jsutil.StartObject();
-		m_jsutil.WriteValue(key);
+		WriteKey(key);
 		WriteObject(t, std::true_type{});
 		m_jsutil.EndObject();
 	}
@@ -115,53 +249,65 @@ private:
 	//	m_jsutil.EndObject();
 	//}
 
-	// variant visitor
-	template <typename BeginObj>
-	struct serialize_visitor : boost::static_visitor<>
+	//a blank kapok::variant and a valueless std::variant are written as null.
+	template <typename T, typename BeginObj>
+	std::enable_if_t<is_variant<T>::value> WriteObject(T const& v, BeginObj)
 	{
-		explicit serialize_visitor(Serializer& s, int which)
-			: s_(s)
-			, which_(which - 1)
-		{
-		}
-
-		template <typename T>
-		void operator() (T const& to_write) const
-		{
-			s_.BeginWriteKV(std::to_string(which_).c_str(), to_write);
-		}
-
-		void operator() (boost::blank) const
-		{	
-			throw std::invalid_argument( "Cannot serialize an uninitialized Variant!" );
-		}
+		using access = detail::variant_access<T>;
+		const size_t index = access::index(v);
+		if (index < access::size)
+			WriteAlternative(v, index, std::make_index_sequence<access::size>{});
+		else
+			WriteNull();
+	}
 
-		Serializer& s_;
-		int which_;
-	};
+	template<typename T, size_t... Is>
+	void WriteAlternative(const T& v, size_t index, std::index_sequence<Is...>)
+	{
+		using writer_t = void(*)(Serializer&, const T&);
+		static const writer_t writers[] = { &WriteAlternativeAt<Is, T>... };
+		writers[index](*this, v);
+	}
 
-	template <typename BeginObj, typename ... Args>
-	void WriteObject(variant<Args...> const& v, BeginObj bj)
+	template<size_t I, typename T>
+	static void WriteAlternativeAt(Serializer& sr, const T& v)
 	{
-		if (static_cast<bool>(v))
-		{
-			//WriteObject(*t, bj);
-			boost::apply_visitor(serialize_visitor<BeginObj>{ *this, v.which() }, v);
-		}
-		else
-		{
-			WriteNull();
-		}
+		using access = detail::variant_access<T>;
+		const std::string& key = detail::variant_keys<access::size>()[I];
+		sr.m_jsutil.WriteRaw(key.data(), key.length());
+		sr.WriteObject(access::template get<I>(v), std::true_type{});
+		sr.m_jsutil.EndObject();
 	}
 
 	template<typename T, typename BeginObjec>
 	typename std::enable_if<is_user_class<T>::value>::type WriteObject(const T& t, BeginObjec)
 	{
 		m_jsutil.StartObject();
-		WriteTuple(((T&)t).Meta());
+		WriteFields(t, std::integral_constant<bool, detail::has_meta_names<T>::value>{});
 		m_jsutil.EndObject();
 	}
 
+	template<typename T>
+	void WriteFields(const T& t, std::false_type)
+	{
+		WriteTuple(((T&)t).Meta());
+	}
+
+	template<typename T>
+	void WriteFields(const T& t, std::true_type)
+	{
+		auto tp = ((T&)t).Meta();
+		WriteFields<T>(tp, std::make_index_sequence<key_fragments<T>::size>{});
+	}
+
+	//the keys and separators are copied from the fragments built at compile time.
+	template<typename T, typename Tuple, std::size_t... Is>
+	void WriteFields(const Tuple& tp, std::index_sequence<Is...>)
+	{
+		(void)std::initializer_list<int>{ (m_jsutil.WriteRaw(key_fragments<T>::data(Is), key_fragments<T>::length_of(Is)),
+			WriteObject(std::get<Is>(tp).second, std::true_type{}), 0)... };
+	}
+
 	template<typename T, typename BeginObjec>
 	typename std::enable_if<is_tuple<T>::value>::type WriteObject(T const& t, BeginObjec)
 	{
@@ -170,60 +316,59 @@ private:
 		m_jsutil.EndArray();
 	}
 
-	template<std::size_t I = 0, typename Tuple>
-	typename std::enable_if<I == std::tuple_size<Tuple>::value>::type WriteTuple(const Tuple& t)
+	template<typename Tuple>
+	void WriteTuple(const Tuple& t)
 	{
+		WriteTuple(t, std::make_index_sequence<std::tuple_size<Tuple>::value>{});
 	}
 
-	template<std::size_t I = 0, typename Tuple>
-	typename std::enable_if<I < std::tuple_size<Tuple>::value>::type WriteTuple(const Tuple& t)
+	template<typename Tuple, std::size_t... Is>
+	void WriteTuple(const Tuple& t, std::index_sequence<Is...>)
 	{
-		WriteObject(std::get<I>(t), std::false_type{});
-		WriteTuple<I + 1>(t);
+		(void)std::initializer_list<int>{ (WriteSeparator<Is>(), WriteObject(std::get<Is>(t), std::false_type{}), 0)... };
 	}
 
-	template<typename T, typename BeginObjec>
-	typename std::enable_if<is_singlevalue_container<T>::value>::type WriteObject(T const& t, BeginObjec)
+	template<std::size_t I>
+	void WriteSeparator()
 	{
-		WriteArray(t);
+		if (I != 0)
+			m_jsutil.WriteSeparator();
 	}
 
-	template <typename Adaptor, typename F>
-	auto WriteAdaptor(Adaptor&& adaptor, F get)
+	template<typename T, typename BeginObjec>
+	typename std::enable_if<is_singlevalue_container<T>::value>::type WriteObject(T const& t, BeginObjec)
 	{
-		using adaptor_t = std::remove_cv_t<std::remove_reference_t<Adaptor>>;
-		adaptor_t temp = std::forward<Adaptor>(adaptor);
-		m_jsutil.StartArray();
-		while (!temp.empty())
-		{
-			WriteObject(get(temp), std::false_type{});
-			temp.pop();
-		}
-		m_jsutil.EndArray();
+		WriteArray(t);
 	}
 
+	//the adaptors are written from their underlying container, without copying and popping them.
+	//a queue starts from the front, a priority_queue keeps its heap order.
 	template <typename T, typename BeginObject>
-	auto WriteObject(T&& t, BeginObject) -> std::enable_if_t<is_queue<T>::value>
+	auto WriteObject(T const& t, BeginObject) -> std::enable_if_t<is_queue<T>::value || is_priority_queue<T>::value>
 	{
-		WriteAdaptor(std::forward<T>(t), [](auto const& adaptor) { return adaptor.front(); });
+		WriteArray(detail::adaptor_access<T>::container(t));
 	}
 
+	//a stack starts from the top, which is the back of the container.
 	template<typename T, typename BeginObject>
-	auto WriteObject(T&& t, BeginObject) -> std::enable_if_t<is_stack<T>::value || is_priority_queue<T>::value>
+	auto WriteObject(T const& t, BeginObject) -> std::enable_if_t<is_stack<T>::value>
 	{
-		WriteAdaptor(std::forward<T>(t), [](auto const& adaptor) { return adaptor.top(); });
+		auto const& c = detail::adaptor_access<T>::container(t);
+		WriteRange(c.rbegin(), c.rend());
 	}
 
 	template<typename T, typename BeginObject>
 	typename std::enable_if<is_map_container<T>::value>::type WriteObject(T const& t, BeginObject)
 	{
 		m_jsutil.StartObject();
-		m_wr.clear();
+		bool first = true;
 		for (auto const& pair : t)
 		{
-			m_wr << pair.first;
-			WriteKV(m_wr.c_str(), pair.second);
-			m_wr.clear();
+			if (!first)
+				m_jsutil.WriteSeparator();
+
+			first = false;
+			WriteKV(pair.first, pair.second);
 		}
 		m_jsutil.EndObject();
 	}
@@ -232,19 +377,14 @@ private:
 	typename std::enable_if<is_pair<T>::value>::type WriteObject(T const& t, std::true_type)
 	{
 		m_jsutil.StartObject();
-		m_wr << t.first;
-		WriteKV(m_wr.c_str(), t.second);
-		m_wr.clear();
+		WriteKV(t.first, t.second);
 		m_jsutil.EndObject();
 	}
 
 	template<typename T>
 	typename std::enable_if<is_pair<T>::value>::type WriteObject(T const& t, std::false_type)
 	{
-		m_wr.clear();
-		m_wr << t.first;
-		WriteKV(m_wr.c_str(), t.second);
-		m_wr.clear();
+		WriteKV(t.first, t.second);
 	}
 
 	template<typename T, size_t N, typename BeginObject>
@@ -273,13 +413,98 @@ private:
 
 	template<typename Array>
 	inline void WriteArray(Array const& v)
+	{
+		WriteRange(std::begin(v), std::end(v));
+	}
+
+	template<typename Iterator>
+	void WriteRange(Iterator first, Iterator last)
 	{
 		m_jsutil.StartArray();
-		for (auto const& i : v)
+		WriteElements(first, last, typename std::iterator_traits<Iterator>::iterator_category{});
+		m_jsutil.EndArray();
+	}
+
+	template<typename Iterator, typename Category>
+	void WriteElements(Iterator first, Iterator last, Category)
+	{
+		for (auto it = first; it != last; ++it)
 		{
-			WriteObject(i, std::false_type{});
+			if (it != first)
+				m_jsutil.WriteSeparator();
+
+			WriteObject(*it, std::false_type{});
+		}
+	}
+
+	template<typename Iterator>
+	void WriteElements(Iterator first, Iterator last, std::random_access_iterator_tag)
+	{
+		const size_t count = static_cast<size_t>(last - first);
+		if (m_threads > 1 && count >= m_parallel_min)
+			WriteParallel(first, count);
+		else
+			WriteElements(first, last, std::input_iterator_tag{});
+	}
+
+	//the slices are four per worker to balance the load, they are joined by the separators here.
+	template<typename Iterator>
+	void WriteParallel(Iterator first, size_t count)
+	{
+		const size_t round = m_jsutil.HasSink() ? (std::max)(m_parallel_min, size_t(1)) : count;
+		for (size_t done = 0; done < count; done += round)
+		{
+			if (done != 0)
+				m_jsutil.WriteSeparator();
+
+			WriteRound(first + done, (std::min)(round, count - done));
+		}
+
+		size_t reserved = 0;
+		for (auto& slice : m_slices)
+			reserved += slice.capacity();
+
+		if (reserved > m_trim_threshold)
+			std::vector<std::string>().swap(m_slices);
+	}
+
+	template<typename Iterator>
+	void WriteRound(Iterator first, size_t count)
+	{
+		if (!m_pool)
+		{
+			m_workers.reset(new Serializer[m_threads]);
+			m_pool.reset(new ThreadPool(m_threads));
+		}
+
+		const size_t slices = (std::min)(m_threads * 4, count);
+		if (m_slices.size() < slices)
+			m_slices.resize(slices);
+
+		const auto format = m_jsutil.GetDoubleFormat();
+		m_pool->Run(slices, [this, first, count, slices, format](size_t i, size_t worker)
+		{
+			m_workers[worker].WriteSlice(first + count * i / slices, first + count * (i + 1) / slices, m_slices[i], format);
+		});
+
+		for (size_t i = 0; i < slices; i++)
+		{
+			if (i != 0)
+				m_jsutil.WriteSeparator();
+
+			m_jsutil.WriteRaw(m_slices[i].data(), m_slices[i].size());
 		}
-		m_jsutil.EndArray();
+	}
+
+	//a worker writes the elements with the writer of one thread, its nested containers are not split.
+	template<typename Iterator>
+	void WriteSlice(Iterator first, Iterator last, std::string& out, JsonUtil::DoubleFormat format)
+	{
+		out.clear();
+		AttachGuard guard{ m_jsutil };
+		m_jsutil.Attach(out);
+		m_jsutil.SetDoubleFormat(format);
+		WriteElements(first, last, std::input_iterator_tag{});
 	}
 
 	template<typename T, typename BeginObject>
@@ -313,19 +538,72 @@ private:
 	//	WriteKV(boost::lexical_cast<std::string>(t.first).c_str(), t.second);
 	//}
 
-	template<typename V>
-	void WriteKV(const char* k, V& v)
+	template<typename K, typename V>
+	void WriteKV(const K& k, V& v)
 	{
-		m_jsutil.WriteValue(k);
+		WriteKey(k);
 		WriteObject(v, std::true_type{});
 	}
 
-	template<typename V>
-	void BeginWriteKV(const char* k, V& v)
+	void WriteKey(const char* k)
 	{
-		m_jsutil.StartObject();
-		WriteKV(k, v);
-		m_jsutil.EndObject();
+		m_jsutil.WriteKey(k, strlen(k));
+	}
+
+	template<typename K>
+	typename std::enable_if<is_string<K>::value>::type WriteKey(const K& k)
+	{
+		m_jsutil.WriteKey(k.data(), k.length());
+	}
+
+	template<typename K>
+	typename std::enable_if<detail::is_integer_key<K>::value && std::is_signed<K>::value>::type WriteKey(K k)
+	{
+		m_jsutil.WriteKey(static_cast<int64_t>(k));
+	}
+
+	template<typename K>
+	typename std::enable_if<detail::is_integer_key<K>::value && std::is_unsigned<K>::value>::type WriteKey(K k)
+	{
+		m_jsutil.WriteKey(static_cast<uint64_t>(k));
+	}
+
+	template<typename K>
+	typename std::enable_if<std::is_enum<K>::value>::type WriteKey(K k)
+	{
+		WriteKey(static_cast<typename std::underlying_type<K>::type>(k));
+	}
+
+	void WriteKey(double k)
+	{
+		m_jsutil.WriteKey(k);
+	}
+
+	void WriteKey(bool k)
+	{
+		WriteKey(k ? "true" : "false");
+	}
+
+	void WriteKey(char k)
+	{
+		m_jsutil.WriteKey(&k, 1);
+	}
+
+	//the other keys are formatted by lexical_cast, the same as they are parsed.
+	template<typename K>
+	typename std::enable_if<!std::is_arithmetic<K>::value && !std::is_enum<K>::value && !is_string<K>::value>::type WriteKey(const K& k)
+	{
+		WriteKey(boost::lexical_cast<std::string>(k));
+	}
+
+	void WriteKey(float k)
+	{
+		m_jsutil.WriteKey(k);
+	}
+
+	void WriteKey(long double k)
+	{
+		WriteKey(boost::lexical_cast<std::string>(k));
 	}
 
 	template<typename T, typename BeginObject>
@@ -341,7 +619,12 @@ private:
 
 private:
 	JsonUtil m_jsutil;
-	fmt::MemoryWriter m_wr;
+	size_t m_threads = 1;
+	size_t m_parallel_min = parallel_min_elements;
+	std::unique_ptr<Serializer[]> m_workers;
+	std::unique_ptr<ThreadPool> m_pool;
+	std::vector<std::string> m_slices;
+	size_t m_trim_threshold = static_cast<size_t>(-1);
 };
 } // namespace kapok
 
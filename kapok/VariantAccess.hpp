@@ -0,0 +1,105 @@
+#pragma once
+#include <array>
+#include <string>
+#include <tuple>
+#include <utility>
+#include "traits.hpp"
+
+namespace kapok {
+namespace detail
+{
+	// The alternatives of the variants by index. The json of an alternative is {"index":value},
+	// index() is npos for a kapok::variant holding boost::blank and for a valueless std::variant.
+	// emplace returns the new alternative, assign reads it with read(alternative&).
+	template<typename T>
+	struct variant_access;
+
+	template<typename... Args>
+	struct variant_access<variant<Args...>>
+	{
+		using type = variant<Args...>;
+		static constexpr size_t size = sizeof...(Args);
+
+		template<size_t I>
+		using alternative = std::tuple_element_t<I, std::tuple<Args...>>;
+
+		static size_t index(const type& v)
+		{
+			return static_cast<size_t>(v.which()) - 1;
+		}
+
+		template<size_t I>
+		static const alternative<I>& get(const type& v)
+		{
+			return boost::get<alternative<I>>(v);
+		}
+
+		//boost::blank is the fallback of boost::variant, so the assignment needs no heap backup.
+		template<size_t I>
+		static alternative<I>& emplace(type& v)
+		{
+			v = alternative<I>();
+			return boost::get<alternative<I>>(v);
+		}
+
+		//boost::variant has no emplace, reading a temporary and moving it in is faster than
+		//reading through boost::get.
+		template<size_t I, typename Read>
+		static void assign(type& v, Read&& read)
+		{
+			alternative<I> value;
+			read(value);
+			v = std::move(value);
+		}
+	};
+
+#ifdef KAPOK_HAS_STD_VARIANT
+	template<typename... Args>
+	struct variant_access<std::variant<Args...>>
+	{
+		using type = std::variant<Args...>;
+		static constexpr size_t size = sizeof...(Args);
+
+		template<size_t I>
+		using alternative = std::variant_alternative_t<I, type>;
+
+		static size_t index(const type& v)
+		{
+			return v.index();
+		}
+
+		template<size_t I>
+		static const alternative<I>& get(const type& v)
+		{
+			return std::get<I>(v);
+		}
+
+		template<size_t I>
+		static alternative<I>& emplace(type& v)
+		{
+			return v.template emplace<I>();
+		}
+
+		template<size_t I, typename Read>
+		static void assign(type& v, Read&& read)
+		{
+			read(v.template emplace<I>());
+		}
+	};
+#endif
+
+	template<size_t... Is>
+	std::array<std::string, sizeof...(Is)> make_variant_keys(std::index_sequence<Is...>)
+	{
+		return {{ ("{\"" + std::to_string(Is) + "\":")... }};
+	}
+
+	//the {"index": fragments opening the alternatives, formatted once.
+	template<size_t N>
+	const std::array<std::string, N>& variant_keys()
+	{
+		static const std::array<std::string, N> keys = make_variant_keys(std::make_index_sequence<N>{});
+		return keys;
+	}
+}
+} // namespace kapok
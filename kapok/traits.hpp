@@ -8,9 +8,17 @@
 #include <set>
 #include <unordered_set>
 #include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
 #include <boost/variant.hpp>
 #include <boost/mpl/at.hpp>
 #include <boost/mpl/remove.hpp>
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <string_view>
+#include <optional>
+#include <variant>
+#define KAPOK_HAS_STRING_VIEW
+#define KAPOK_HAS_STD_VARIANT
+#endif
 
 //using namespace std;
 
@@ -138,6 +146,26 @@ namespace detail
 //	HAS_XXX_TYPE(const_iterator)
 //	HAS_XXX_TYPE(mapped_type)
 
+	//access the protected underlying container(and comparator) of std::queue, std::stack and std::priority_queue.
+	template<typename Adaptor>
+	struct adaptor_access : Adaptor
+	{
+		static auto& container(Adaptor& a)
+		{
+			return a.*(&adaptor_access::c);
+		}
+
+		static auto const& container(Adaptor const& a)
+		{
+			return a.*(&adaptor_access::c);
+		}
+
+		static auto& compare(Adaptor& a)
+		{
+			return a.*(&adaptor_access::comp);
+		}
+	};
+
 	template<typename T> struct is_poiner_extent : std::false_type{};
 	template<typename T> struct is_poiner_extent<std::shared_ptr<T>> : std::true_type{};
 	template<typename T> struct is_poiner_extent<std::unique_ptr<T>> : std::true_type{};
@@ -157,14 +185,20 @@ struct is_std_array : std::false_type {};
 template <typename T, std::size_t N>
 struct is_std_array<std::array<T, N>> : std::true_type {};
 
+//the views are read as strings too, they point into the parsed text (see DeSerializer::ParseInsitu).
 template<typename T>
-struct is_string : std::integral_constant<bool, std::is_same<detail::decay_t<T>, std::string>::value>{};
+struct is_string : std::integral_constant<bool, std::is_same<detail::decay_t<T>, std::string>::value
+	|| std::is_same<detail::decay_t<T>, boost::string_ref>::value
+#ifdef KAPOK_HAS_STRING_VIEW
+	|| std::is_same<detail::decay_t<T>, std::string_view>::value
+#endif
+	>{};
 
 template <typename T>
 struct is_container : public std::integral_constant<bool, detail::has_const_iterator<detail::decay_t<T>>::value&&detail::has_begin_end<detail::decay_t<T>>::value&&!is_string<T>::value>{};
 
 template <typename T>
-struct is_singlevalue_container : public std::integral_constant<bool, !is_std_array<T>::value&&!std::is_array<detail::decay_t<T>>::value&&!detail::is_tuple<detail::decay_t<T>>::value && is_container<detail::decay_t<T>>::value&&!detail::has_mapped_type<detail::decay_t<T>>::value>{};
+struct is_singlevalue_container : public std::integral_constant<bool, !is_std_array<detail::decay_t<T>>::value&&!std::is_array<detail::decay_t<T>>::value&&!detail::is_tuple<detail::decay_t<T>>::value && is_container<detail::decay_t<T>>::value&&!detail::has_mapped_type<detail::decay_t<T>>::value>{};
 
 template <typename T>
 struct is_map_container : public std::integral_constant<bool, is_container<detail::decay_t<T>>::value&&detail::has_mapped_type<detail::decay_t<T>>::value>{};
@@ -189,7 +223,12 @@ struct is_specialization_of : std::false_type {};
 template <template <typename...> class Template, typename... Args>
 struct is_specialization_of<Template<Args...>, Template> : std::true_type{};
 
+#ifdef KAPOK_HAS_STD_VARIANT
+template <typename T> struct is_optional : std::integral_constant<bool, is_specialization_of<detail::decay_t<T>, boost::optional>::value
+	|| is_specialization_of<detail::decay_t<T>, std::optional>::value> {};
+#else
 template <typename T> struct is_optional : is_specialization_of<detail::decay_t<T>, boost::optional> {};
+#endif
 template <typename T> struct is_tuple : is_specialization_of<detail::decay_t<T>, std::tuple>{};
 template <typename T> struct is_queue : is_specialization_of<detail::decay_t<T>, std::queue>{};
 template <typename T> struct is_stack : is_specialization_of<detail::decay_t<T>, std::stack>{};
@@ -198,7 +237,12 @@ template <typename T> struct is_multiset : is_specialization_of<detail::decay_t<
 template <typename T> struct is_unordered_set : is_specialization_of<detail::decay_t<T>, std::unordered_set> {};
 template <typename T> struct is_priority_queue : is_specialization_of<detail::decay_t<T>, std::priority_queue>{};
 template <typename T> struct is_pair : is_specialization_of<detail::decay_t<T>, std::pair> {};
+#ifdef KAPOK_HAS_STD_VARIANT
+template <typename T> struct is_variant : std::integral_constant<bool, is_specialization_of<detail::decay_t<T>, variant>::value
+	|| is_specialization_of<detail::decay_t<T>, std::variant>::value> {};
+#else
 template <typename T> struct is_variant : is_specialization_of<detail::decay_t<T>, variant> {};
+#endif
 
 
 //#define IS_TEMPLATE_CLASS(token)
@@ -216,7 +260,7 @@ struct is_container_adapter : std::integral_constant<bool, is_queue<T>::value ||
 
 template<typename T>
 struct is_user_class : std::integral_constant<bool, is_normal_class<T>::value&&!is_container_adapter<T>::value
-	&&!is_stack<T>::value&&!is_container<T>::value&&!is_tuple<T>::value&&!is_pair<T>::value&&!is_optional<T>::value>
+	&&!is_stack<T>::value&&!is_container<T>::value&&!is_tuple<T>::value&&!is_pair<T>::value&&!is_optional<T>::value&&!is_variant<T>::value>
 {};
 
 } // namespace kapok
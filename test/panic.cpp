@@ -1,5 +1,6 @@
 #include "unit_test.hpp"
 #include "kapok/Kapok.hpp"
+#include <map>
 
 TEST_CASE(deserialize_with_wrong_key)
 {
@@ -39,3 +40,53 @@ TEST_CASE(deserialize_with_invalid_string)
     TEST_CHECK(flag && "should throw invalid_argument exception");
     
 }
+
+TEST_CASE(try_parse_and_deserialize_error_codes)
+{
+	using namespace kapok;
+	struct friend_t
+	{
+		int id;
+		std::map<std::string, int> age;
+
+		META(id, age);
+	};
+
+	struct T
+	{
+		std::string name;
+		std::vector<friend_t> c;
+
+		META(name, c);
+	};
+
+	DeSerializer dr;
+	TEST_CHECK(!dr.TryParse(R"({"T":{"name":"tom",]})"));
+	TEST_CHECK(dr.GetError().code == ErrorCode::parse_error);
+	TEST_CHECK(dr.GetError().offset == 19);
+
+	T t;
+	TEST_CHECK(dr.TryParse(R"({"T":{"name":"tom","c":[{"id":1},{"id":2,"age":[3]}]}})"));
+	TEST_CHECK(!dr.TryDeserialize(t, "T"));
+	TEST_CHECK(dr.GetError().code == ErrorCode::type_mismatch);
+	TEST_CHECK(std::string(dr.GetError().GetPath()) == "/T/c/1/age");
+	TEST_CHECK(t.name == "tom" && t.c.size() == 2 && t.c[1].id == 2);
+
+	std::map<int, int> m;
+	dr.Parse(R"({"m/~":{"1":1,"x":2}})");
+	TEST_CHECK(!dr.TryDeserialize(m, "m/~"));
+	TEST_CHECK(dr.GetError().code == ErrorCode::bad_key);
+	TEST_CHECK(std::string(dr.GetError().GetPath()) == "/m~1~0/x");
+
+	TEST_CHECK(!dr.TryDeserialize(m, "n"));
+	TEST_CHECK(dr.GetError().code == ErrorCode::key_not_found);
+
+	dr.Parse(R"({"m":{"1":1}})");
+	TEST_CHECK(dr.TryDeserialize(m, "m") && !dr.GetError());
+
+	SaxDeSerializer sax;
+	std::map<int, std::vector<int>> v;
+	TEST_CHECK(!sax.TryDeserialize(v, R"({"1":[1],"2":{}})"));
+	TEST_CHECK(sax.GetError().code == ErrorCode::type_mismatch);
+	TEST_CHECK(sax.GetError().offset == 14);
+}
@@ -1,5 +1,8 @@
 #include "unit_test.hpp"
 #include "kapok/Kapok.hpp"
+#include <cmath>
+#include <limits>
+#include <cstring>
 
 TEST_CASE(char_serialize)
 {
@@ -59,3 +62,251 @@ TEST_CASE(array_deserialize)
     TEST_CHECK(v[3] == 4);
     TEST_CHECK(v[4] == 5);
 }
+
+TEST_CASE(number_serialize)
+{
+	using namespace kapok;
+    Serializer sr;
+    sr.Serialize(std::make_tuple(-2147483647 - 1, 4294967295u, INT64_MIN, UINT64_MAX, 0.5, true, false), "numbers");
+    TEST_CHECK(sr.GetString() == std::string(R"({"numbers":[-2147483648,4294967295,-9223372036854775808,18446744073709551615,0.5,true,false]})"));
+}
+
+TEST_CASE(string_escape_serialize)
+{
+	using namespace kapok;
+    Serializer sr;
+    sr.Serialize(std::string("a\"b\\c\n\t\x01\xe4\xb8\xad"), "escape");
+    TEST_CHECK(sr.GetString() == std::string("{\"escape\":\"a\\\"b\\\\c\\n\\t\\u0001\xe4\xb8\xad\"}"));
+
+    DeSerializer dr;
+    dr.Parse(sr.GetString());
+    std::string v;
+    dr.Deserialize(v, "escape");
+    TEST_CHECK(v == "a\"b\\c\n\t\x01\xe4\xb8\xad");
+}
+
+TEST_CASE(string_escape_scan)
+{
+	using namespace kapok;
+	//every escape position inside and around the 16 and 32 byte blocks, with utf-8 bytes around.
+	const char specials[] = { '"', '\\', '\n', '\x1f', '\0' };
+	for (size_t length = 1; length < 80; length++)
+	{
+		for (size_t pos = 0; pos <= length; pos++)
+		{
+			for (char c : specials)
+			{
+				std::string s(length, '\xe4');
+				for (size_t i = 0; i < length; i += 3)
+					s[i] = 'a';
+				if (pos < length)
+					s[pos] = c;
+
+				const char* end = s.data() + s.size();
+				TEST_CHECK(detail::find_escape(s.data(), end) == s.data() + pos);
+#ifdef KAPOK_ESCAPE_SSE2
+				TEST_CHECK(detail::find_escape_sse2(s.data(), end) == s.data() + pos);
+#endif
+			}
+		}
+	}
+
+	std::string text(1000, 'x');
+	text[500] = '"';
+	Serializer sr;
+	sr.Serialize(text, "text");
+	DeSerializer dr;
+	dr.Parse(sr.GetString());
+	std::string v;
+	dr.Deserialize(v, "text");
+	TEST_CHECK(v == text);
+}
+
+TEST_CASE(float_shortest_round_trip)
+{
+	using namespace kapok;
+	Serializer sr;
+	sr.Serialize(std::vector<float>{ 0.1f, -1.5f, 3.0f, 1e-7f, 33592648.0f, 0.0f }, "f");
+	TEST_CHECK(sr.GetString() == std::string(R"({"f":[0.1,-1.5,3.0,1e-7,33592650.0,0.0]})"));
+
+	//the smallest subnormal, the smallest normal, the biggest float and some random ones.
+	std::vector<float> v{ std::numeric_limits<float>::denorm_min(), std::numeric_limits<float>::min(),
+		std::numeric_limits<float>::max(), -0.0f, 16777216.0f, 8388609.0f, 7.03853069e-26f };
+	uint32_t bits = 12345;
+	for (int i = 0; i < 10000; i++)
+	{
+		bits = bits * 1664525 + 1013904223;
+		float f;
+		std::memcpy(&f, &bits, sizeof(f));
+		if (f == f && std::abs(f) <= std::numeric_limits<float>::max())
+			v.push_back(f);
+	}
+	sr.Serialize(v, "f");
+
+	std::vector<float> rv;
+	DeSerializer dr;
+	dr.SetExactFloats(true);
+	dr.Parse(sr.GetString());
+	dr.Deserialize(rv, "f");
+	TEST_CHECK(rv == v);
+
+	std::vector<float> sv;
+	SaxDeSerializer sdr;
+	sdr.Deserialize(sv, sr.GetString(), "f");
+	TEST_CHECK(sv == v);
+
+	//the nearest double of 7.038531e-26 is exactly the middle of two floats, the float is read from
+	//the digits. The same double from other digits still rounds to even.
+	sr.Serialize(7.038531e-26f, "f");
+	TEST_CHECK(sr.GetString() == std::string(R"({"f":7.038531e-26})"));
+	const std::string ties = R"({"f":[1,{"a":[7.038531e-26,1],"b":-7.038531e-26},7.0385306e-26,7.038531e-26,16777217,3.4028235677973366e38]})";
+	const std::vector<float> expected = { 7.038531e-26f, -7.038531e-26f, 7.0385306e-26f, 7.038531e-26f, 16777216.0f, std::numeric_limits<float>::max() };
+	struct tie_t
+	{
+		std::vector<float> a;
+		float b;
+
+		META(a, b);
+	};
+	const std::vector<float> expected_a = { expected[0], 1.0f };
+	std::tuple<int, tie_t, float, float, float, float> t;
+	dr.Parse(ties);
+	dr.Deserialize(t, "f");
+	TEST_CHECK(std::get<1>(t).a == expected_a && std::get<1>(t).b == expected[1]);
+	TEST_CHECK(std::get<2>(t) == expected[2] && std::get<3>(t) == expected[3] && std::get<4>(t) == expected[4] && std::get<5>(t) == expected[5]);
+
+	t = {};
+	std::string insitu = ties;
+	dr.ParseInsitu(&insitu[0], insitu.size());
+	dr.Deserialize(t, "f");
+	TEST_CHECK(std::get<1>(t).a == expected_a && std::get<1>(t).b == expected[1]);
+	TEST_CHECK(std::get<2>(t) == expected[2] && std::get<3>(t) == expected[3] && std::get<4>(t) == expected[4] && std::get<5>(t) == expected[5]);
+
+	t = {};
+	sdr.Deserialize(t, ties, "f");
+	TEST_CHECK(std::get<1>(t).a == expected_a && std::get<1>(t).b == expected[1]);
+	TEST_CHECK(std::get<2>(t) == expected[2] && std::get<3>(t) == expected[3] && std::get<4>(t) == expected[4] && std::get<5>(t) == expected[5]);
+
+	//without SetExactFloats the document keeps no side table, the double is rounded to float.
+	DeSerializer cast;
+	cast.Parse(ties);
+	t = {};
+	cast.Deserialize(t, "f");
+	TEST_CHECK(std::get<3>(t) == static_cast<float>(7.038531e-26) && std::get<3>(t) != expected[3]);
+	TEST_CHECK(std::get<2>(t) == expected[2] && std::get<4>(t) == expected[4]);
+
+	//the workers of a parallel read share the floats of the document.
+	std::vector<float> many(100, 7.038531e-26f);
+	sr.Serialize(many, "f");
+	DeSerializer pdr;
+	pdr.SetExactFloats(true);
+	pdr.SetParallel(3, 2);
+	pdr.Parse(sr.GetString());
+	rv.clear();
+	pdr.Deserialize(rv, "f");
+	TEST_CHECK(rv == many);
+}
+
+TEST_CASE(double_format_engines)
+{
+	using namespace kapok;
+	Serializer sr;
+	sr.Serialize(std::vector<double>{ 0.1, -65.613616999999977, 1e23, 5e-324, 1.7976931348623157e308, 2.2250738585072014e-308, -0.0, 100.0 }, "d");
+	TEST_CHECK(sr.GetString() == std::string(R"({"d":[0.1,-65.61361699999998,1e23,5e-324,1.7976931348623157e308,2.2250738585072014e-308,-0.0,100.0]})"));
+
+	//the shortest digits read back to the same double.
+	uint64_t bits = 88172645463325252ull;
+	for (int i = 0; i < 10000; i++)
+	{
+		bits ^= bits << 13;
+		bits ^= bits >> 7;
+		bits ^= bits << 17;
+		double d;
+		std::memcpy(&d, &bits, sizeof(d));
+		if (!std::isfinite(d))
+			continue;
+
+		sr.Serialize(d);
+		TEST_CHECK(std::strtod(sr.GetString(), nullptr) == d);
+	}
+
+	sr.SetDoubleFormat<precision<6>>();
+	sr.Serialize(std::vector<double>{ -65.613616999999977, 0.5, 2.0000004, 1e300, -0.0000001, 123456.0000005 }, "d");
+	TEST_CHECK(sr.GetString() == std::string(R"({"d":[-65.613617,0.5,2.0,1e300,-0.0,123456.000001]})"));
+
+	//the exact halves go to the even digit as in %.2f, the others round by their exact value.
+	sr.SetDoubleFormat<precision<2>>();
+	sr.Serialize(std::vector<double>{ 0.125, 0.375, -2.625, 1.005, 1.015, 0.145 }, "d");
+	TEST_CHECK(sr.GetString() == std::string(R"({"d":[0.12,0.38,-2.62,1.0,1.01,0.14]})"));
+
+	sr.SetDoubleFormat<grisu2>();
+	sr.Serialize(0.3, "d");
+	TEST_CHECK(sr.GetString() == std::string(R"({"d":0.3})"));
+}
+
+TEST_CASE(double_parse_correctly_rounded)
+{
+	using namespace kapok;
+	const char* json = R"({"d":[2.2250738585072011e-308,1.00000000000000011102230246251565404236316680908203125,)"
+		R"(1.00000000000000011102230246251565404236316680908203126,7.038531e-26,-65.61361699999998,)"
+		R"(4.9406564584124654e-324,2.4703282292062327e-324,9007199254740993,1e23]})";
+	const std::vector<double> expected = { 2.2250738585072009e-308, 1.0, 1.0000000000000002, 7.038531e-26,
+		-65.613616999999977, 5e-324, 0.0, 9007199254740992.0, 1e23 };
+
+	std::vector<double> v;
+	DeSerializer dr;
+	dr.Parse(json);
+	dr.Deserialize(v, "d");
+	TEST_CHECK(v == expected);
+
+	v.clear();
+	SaxDeSerializer sax;
+	sax.Deserialize(v, json, std::strlen(json), "d");
+	TEST_CHECK(v == expected);
+
+	//the caller's text ends at its length, the number is not read past it.
+	const char* text = "1.2534";
+	double d = 0;
+	dr.Parse(text, 3);
+	dr.Deserialize(d);
+	TEST_CHECK(d == 1.2);
+
+	//a double out of range is rejected like rapidjson does, not read as an infinity.
+	const std::string too_big = R"({"d":[1,1e400]})";
+	TEST_CHECK(!dr.TryParse(too_big));
+	TEST_CHECK(dr.GetError().code == ErrorCode::parse_error && dr.GetError().offset == 8);
+	TEST_CHECK(std::strcmp(dr.GetError().message, rapidjson::GetParseError_En(rapidjson::kParseErrorNumberTooBig)) == 0);
+	TEST_CHECK(!dr.TryParseCopy(too_big.data(), too_big.size()));
+	TEST_CHECK(!sax.TryDeserialize(v, std::string(R"({"d":[-1e999]})"), "d"));
+	TEST_CHECK(sax.GetError().offset == 6);
+	TEST_CHECK(std::strcmp(sax.GetError().message, rapidjson::GetParseError_En(rapidjson::kParseErrorNumberTooBig)) == 0);
+
+	std::vector<int64_t> n;
+	dr.Parse(std::string("[-3,0.5e1,-9223372036854775808]"));
+	dr.Deserialize(n);
+	TEST_CHECK(n == std::vector<int64_t>({ -3, 0, INT64_MIN }));
+
+	//the shortest digits of the Serializer read back to the same double on both paths.
+	Serializer sr;
+	uint64_t bits = 88172645463325252ull;
+	for (int i = 0; i < 10000; i++)
+	{
+		bits ^= bits << 13;
+		bits ^= bits >> 7;
+		bits ^= bits << 17;
+		double d;
+		std::memcpy(&d, &bits, sizeof(d));
+		if (!std::isfinite(d))
+			continue;
+
+		sr.Serialize(d, "d");
+		double r = 0;
+		dr.Parse(sr.GetString());
+		dr.Deserialize(r, "d");
+		TEST_CHECK(std::memcmp(&r, &d, sizeof(d)) == 0);
+
+		r = 0;
+		sax.Deserialize(r, sr.GetString(), std::strlen(sr.GetString()), "d");
+		TEST_CHECK(std::memcmp(&r, &d, sizeof(d)) == 0);
+	}
+}
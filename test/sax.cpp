@@ -0,0 +1,273 @@
+#include "unit_test.hpp"
+#include "kapok/Kapok.hpp"
+#include <map>
+#include <list>
+#include <unordered_map>
+
+namespace
+{
+	struct sax_person
+	{
+		int age;
+		std::string name;
+
+		bool operator==(const sax_person& p) const
+		{
+			return age == p.age && name == p.name;
+		}
+
+		bool operator<(const sax_person& p) const
+		{
+			return age < p.age;
+		}
+
+		META(age, name);
+	};
+
+	enum class sax_color
+	{
+		red = 1,
+		blue = 2,
+	};
+
+	struct sax_complex
+	{
+		int a;
+		std::string b;
+		std::map<std::string, sax_person> c;
+		std::vector<std::map<std::string, std::vector<sax_person>>> d;
+		std::tuple<int, std::string, std::vector<double>> e;
+		std::array<sax_person, 2> f;
+		boost::optional<sax_person> g;
+		boost::optional<int> h;
+		sax_color i;
+		kapok::variant<int, std::string, sax_person> k;
+		std::map<int, std::list<int>> l;
+		std::set<std::vector<int>> m;
+
+		META(a, b, c, d, e, f, g, h, i, k, l, m);
+	};
+}
+
+TEST_CASE(sax_user_type)
+{
+	using namespace kapok;
+	sax_complex src{ 1, "b", { { "c", { 20, "tom" } } }, { { { "d", { { 21, "jack" }, { 22, "mike" } } } } },
+		std::make_tuple(3, "e", std::vector<double>{ 0.5, 1.5 }), { { { 23, "f1" }, { 24, "f2" } } },
+		sax_person{ 25, "g" }, boost::none, sax_color::blue, {},
+		{ { 1, { 1, 2 } }, { 2, { 3 } } }, { { 1, 2 }, { 3 } } };
+	src.k = sax_person{ 26, "k" };
+
+	Serializer sr;
+	sr.Serialize(src, "complex");
+	std::string json = sr.GetString();
+
+	sax_complex t{};
+	SaxDeSerializer dr;
+	dr.Deserialize(t, json, "complex");
+
+	TEST_CHECK(t.a == 1);
+	TEST_CHECK(t.b == "b");
+	TEST_CHECK(t.c == src.c);
+	TEST_CHECK(t.d == src.d);
+	TEST_CHECK(t.e == src.e);
+	TEST_CHECK(t.f == src.f);
+	TEST_CHECK(t.g == src.g);
+	TEST_CHECK(!t.h);
+	TEST_CHECK(t.i == sax_color::blue);
+	TEST_CHECK(t.k == src.k);
+	TEST_CHECK(t.l == src.l);
+	TEST_CHECK(t.m == src.m);
+
+	sr.Serialize(t, "complex");
+	TEST_CHECK(json == sr.GetString());
+}
+
+TEST_CASE(sax_without_root)
+{
+	using namespace kapok;
+	std::string json = R"({"name":"tom","unknown":{"x":[1,{"y":2}]},"age":20})";
+	SaxDeSerializer dr;
+	auto p = dr.Deserialize<sax_person>(json.c_str(), json.length());
+	TEST_CHECK(p.age == 20);
+	TEST_CHECK(p.name == "tom");
+
+	std::vector<int> v;
+	dr.Deserialize(v, "[1,2,3]");
+	TEST_CHECK(v == (std::vector<int>{ 1, 2, 3 }));
+
+	int arr[3] = {};
+	dr.Deserialize(arr, R"({"array":[4,5,6,7]})", nullptr);
+	TEST_CHECK(arr[0] == 4 && arr[1] == 5 && arr[2] == 6);
+
+	std::pair<int, std::string> pair;
+	dr.Deserialize(pair, R"({"1":"one"})");
+	TEST_CHECK(pair.first == 1 && pair.second == "one");
+}
+
+TEST_CASE(sax_duplicate_map_keys)
+{
+	using namespace kapok;
+	const char* json = R"({"m":{"a":1,"b":2,"a":3},"v":{"a":[1],"a":[2,{"x":3}]}})";
+	std::map<std::string, int> m, dom_m;
+	std::unordered_map<std::string, std::vector<int>> v;
+	SaxDeSerializer dr;
+	dr.Deserialize(m, json, "m");
+	dr.Deserialize(v, json, "v");
+
+	DeSerializer dom;
+	dom.Parse(json);
+	dom.Deserialize(dom_m, "m");
+	TEST_CHECK(m == dom_m);
+	TEST_CHECK(m["a"] == 1 && m["b"] == 2);
+	TEST_CHECK(v.size() == 1 && v["a"] == std::vector<int>{ 1 });
+}
+
+TEST_CASE(sax_duplicate_fields)
+{
+	using namespace kapok;
+	struct tagged
+	{
+		int id;
+		std::vector<int> tags;
+		sax_person owner;
+
+		META(id, tags, owner);
+	};
+
+	const char* json = R"({"id":1,"tags":[1],"owner":{"age":2,"name":"a","age":3},"id":4,"tags":[2,3],"owner":{"age":5}})";
+	tagged t = {};
+	SaxDeSerializer dr;
+	dr.Deserialize(t, json, std::strlen(json));
+
+	tagged dom_t = {};
+	DeSerializer dom;
+	dom.Parse(json);
+	dom.Deserialize(dom_t);
+	TEST_CHECK(t.id == 1 && t.tags == std::vector<int>{ 1 } && t.owner == (sax_person{ 2, "a" }));
+	TEST_CHECK(dom_t.id == t.id && dom_t.tags == t.tags && dom_t.owner == t.owner);
+}
+
+TEST_CASE(sax_duplicate_root_key)
+{
+	using namespace kapok;
+	const char* json = R"({"p":{"age":1,"name":"a"},"q":2,"p":{"age":3},"v":[1],"v":[2,3]})";
+	sax_person p{ 0, "" }, dom_p{ 0, "" };
+	std::vector<int> v;
+	SaxDeSerializer dr;
+	dr.Deserialize(p, json, std::strlen(json), "p");
+	dr.Deserialize(v, json, std::strlen(json), "v");
+
+	DeSerializer dom;
+	dom.Parse(json);
+	dom.Deserialize(dom_p, "p");
+	TEST_CHECK(p == (sax_person{ 1, "a" }) && p == dom_p);
+	TEST_CHECK(v == std::vector<int>{ 1 });
+}
+
+TEST_CASE(sax_adaptor)
+{
+	using namespace kapok;
+	SaxDeSerializer dr;
+	std::stack<int> s;
+	dr.Deserialize(s, R"({"stack":[1,2,3]})", "stack");
+	for (int i = 1; i <= 3; i++)
+	{
+		TEST_CHECK(s.top() == i);
+		s.pop();
+	}
+
+	std::queue<sax_person> q;
+	dr.Deserialize(q, R"({"queue":[{"age":1,"name":"a"},{"age":2,"name":"b"}]})", "queue");
+	TEST_CHECK(q.size() == 2 && q.front().name == "a");
+
+	std::priority_queue<int> pq;
+	dr.Deserialize(pq, R"({"pq":[2,5,1]})", "pq");
+	TEST_CHECK(pq.top() == 5);
+}
+
+TEST_CASE(sax_errors)
+{
+	using namespace kapok;
+	SaxDeSerializer dr;
+	sax_person p;
+
+	bool flag = false;
+	try
+	{
+		dr.Deserialize(p, R"({"person":{"age":1}})", "nobody");
+	}
+	catch (std::invalid_argument&)
+	{
+		flag = true;
+	}
+	TEST_CHECK(flag && "should throw invalid_argument exception");
+
+	flag = false;
+	try
+	{
+		dr.Deserialize(p, R"({"age":1,)");
+	}
+	catch (std::invalid_argument&)
+	{
+		flag = true;
+	}
+	TEST_CHECK(flag && "should throw invalid_argument exception");
+
+	flag = false;
+	try
+	{
+		dr.Deserialize(p, R"([1,2])");
+	}
+	catch (std::invalid_argument&)
+	{
+		flag = true;
+	}
+	TEST_CHECK(flag && "should throw invalid_argument exception");
+
+	dr.Deserialize(p, R"({"age":30,"name":"jerry"})");
+	TEST_CHECK(p.age == 30 && p.name == "jerry");
+}
+
+TEST_CASE(projection_skips_undeclared_members)
+{
+	using namespace kapok;
+	struct envelope
+	{
+		int id;
+		std::string type;
+		sax_person from;
+
+		META(id, type, from);
+	};
+
+	std::string json = R"({"msg": {"payload":{"a":[1,{"b":"}]\"{["}],"c":"x\\"},)"
+		R"("id":7, "from":{"name":"tom","blob":[[[]]],"age":30},"type":"order","tail":[]}})";
+
+	ProjectionDeSerializer dr;
+	envelope e = {};
+	dr.Deserialize(e, json, "msg");
+	TEST_CHECK(e.id == 7 && e.type == "order" && e.from == (sax_person{ 30, "tom" }));
+
+	envelope first = {};
+	dr.Deserialize(first, json.c_str(), json.length(), nullptr);
+	TEST_CHECK(first.id == 7);
+
+	//a key written with escapes still names its field.
+	sax_person p = {};
+	dr.Deserialize(p, std::string(R"({"\u0061ge":5,"x":{"name":"no"},"name":"jerry"})"));
+	TEST_CHECK(p == (sax_person{ 5, "jerry" }));
+
+	//the first value of a repeated key is kept.
+	dr.Deserialize(e, std::string(R"({"id":1,"from":{"age":2,"age":3},"id":4,"from":{"age":5}})"));
+	TEST_CHECK(e.id == 1 && e.from.age == 2);
+
+	TEST_CHECK(!dr.TryDeserialize(e, json, "nobody"));
+	TEST_CHECK(dr.GetError().code == ErrorCode::key_not_found);
+
+	//a broken skipped value is found by the bracket matching, a broken wanted value by the reader.
+	TEST_CHECK(!dr.TryDeserialize(p, std::string(R"({"x":[1,2,"age":1})")));
+	TEST_CHECK(dr.GetError().code == ErrorCode::parse_error);
+	TEST_CHECK(!dr.TryDeserialize(e, std::string(R"({"x":1,"from":[1]})")));
+	TEST_CHECK(dr.GetError().code == ErrorCode::type_mismatch && dr.GetError().offset == 15);
+}
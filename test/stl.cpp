@@ -2,6 +2,9 @@
 #include "kapok/Kapok.hpp"
 #include <map>
 #include <unordered_map>
+#include <deque>
+#include <stack>
+#include <sstream>
 
 TEST_CASE(string_serialize)
 {
@@ -104,6 +107,46 @@ TEST_CASE(stack_deserialize)
     }
 }
 
+TEST_CASE(priority_queue_round_trip)
+{
+	using namespace kapok;
+	std::priority_queue<int, std::vector<int>, std::greater<int>> pq;
+	std::stack<int, std::vector<int>> st;
+	for (int i : { 5, 1, 4, 2, 3, 9, 0 })
+	{
+		pq.push(i);
+		st.push(i);
+	}
+
+	Serializer sr;
+	sr.Serialize(std::make_tuple(pq, st), "adaptors");
+	TEST_CHECK(pq.size() == 7 && st.size() == 7);
+
+	decltype(pq) rpq;
+	decltype(st) rst;
+	auto t = std::tie(rpq, rst);
+	DeSerializer dr;
+	dr.Parse(sr.GetString());
+	dr.Deserialize(t, "adaptors");
+	for (int i = 0; i < 10; i++)
+	{
+		if (i == 6 || i == 7 || i == 8)
+			continue;
+
+		TEST_CHECK(rpq.top() == i);
+		rpq.pop();
+	}
+	TEST_CHECK(rpq.empty());
+
+	while (!st.empty())
+	{
+		TEST_CHECK(rst.top() == st.top());
+		rst.pop();
+		st.pop();
+	}
+	TEST_CHECK(rst.empty());
+}
+
 TEST_CASE(set_serialize)
 {
 	using namespace kapok;
@@ -163,6 +206,54 @@ TEST_CASE(map_deserialize)
     TEST_CHECK(v == (std::map<std::string, int>{{"1", 1}, {"2", 2}, {"3", 3}}));
 }
 
+TEST_CASE(map_number_key)
+{
+	using namespace kapok;
+	enum class color { red = 1, blue = 2 };
+	std::map<int64_t, int> m1{ { INT64_MIN, 1 }, { -5, 2 }, { 0, 3 }, { INT64_MAX, 4 } };
+	std::map<uint64_t, int> m2{ { 0, 1 }, { UINT64_MAX, 2 } };
+	std::map<color, int> m3{ { color::red, 1 }, { color::blue, 2 } };
+	std::map<char, int> m4{ { 'a', 1 } };
+
+	Serializer sr;
+	sr.Serialize(std::make_tuple(m1, m2, m3, m4), "m");
+	TEST_CHECK(sr.GetString() == std::string(R"({"m":[{"-9223372036854775808":1,"-5":2,"0":3,"9223372036854775807":4},)"
+		R"({"0":1,"18446744073709551615":2},{"1":1,"2":2},{"a":1}]})"));
+
+	std::tuple<decltype(m1), decltype(m2), decltype(m3), decltype(m4)> t;
+	DeSerializer dr;
+	dr.Parse(sr.GetString());
+	dr.Deserialize(t, "m");
+	TEST_CHECK(t == std::make_tuple(m1, m2, m3, m4));
+
+	std::tuple<decltype(m1), decltype(m2), decltype(m3), decltype(m4)> st;
+	SaxDeSerializer sdr;
+	sdr.Deserialize(st, sr.GetString(), "m");
+	TEST_CHECK(st == t);
+
+	const char* bad[] = { R"({"m":{"128":1}})", R"({"m":{"-129":1}})", R"({"m":{"1x":1}})", R"({"m":{"":1}})" };
+	for (auto json : bad)
+	{
+		bool flag = false;
+		try
+		{
+			std::map<int8_t, int> m;
+			dr.Parse(json);
+			dr.Deserialize(m, "m");
+		}
+		catch (std::invalid_argument&)
+		{
+			flag = true;
+		}
+		TEST_CHECK(flag && "should throw invalid_argument exception");
+	}
+
+	std::map<int8_t, int> m;
+	dr.Parse(R"({"m":{"-128":1,"127":2}})");
+	dr.Deserialize(m, "m");
+	TEST_CHECK(m[-128] == 1 && m[127] == 2);
+}
+
 TEST_CASE(unordered_map_serialize_and_deserialize)
 {
 	using namespace kapok;
@@ -211,3 +302,209 @@ TEST_CASE(stl_with_user_type)
     dr.Deserialize(v, "temp");
     TEST_CHECK(v == (std::vector<T>{{"k1", "v1"}, T{"k2", "v2"}, T{"k3", "v3"}})); 
 }
+
+TEST_CASE(nested_containers_in_place)
+{
+	using namespace kapok;
+	struct item
+	{
+		std::string name;
+		std::array<int, 3> code;
+		int ids[2];
+
+		META(name, code, ids);
+	};
+
+	std::vector<std::map<std::string, std::vector<item>>> v(3);
+	for (int i = 0; i < 3; i++)
+	{
+		v[i]["a" + std::to_string(i)] = std::vector<item>(2, item{ "x", { { i, 1, 2 } }, { i, 7 } });
+		v[i]["b"] = std::vector<item>(i, item{ "y", { { 3, 4, 5 } }, { 8, i } });
+	}
+
+	Serializer sr;
+	sr.Serialize(v, "v");
+	DeSerializer dr;
+	dr.Parse(sr.GetString());
+	std::vector<std::map<std::string, std::vector<item>>> rv;
+	dr.Deserialize(rv, "v");
+	TEST_REQUIRE(rv.size() == 3);
+	TEST_CHECK(rv[2]["a2"].size() == 2 && rv[2]["a2"][1].code[0] == 2 && rv[2]["a2"][1].ids[0] == 2);
+	TEST_CHECK(rv[2]["b"].size() == 2 && rv[2]["b"][1].name == "y" && rv[2]["b"][1].code[2] == 5 && rv[2]["b"][1].ids[1] == 2);
+	TEST_CHECK(rv[0]["b"].empty());
+
+	std::set<std::string> s;
+	std::unordered_set<int> us;
+	std::vector<bool> vb;
+	std::multimap<int, std::vector<int>> mm;
+	dr.Parse(R"({"s":["a","b","c","a"],"us":[3,1,2],"vb":[true,false,true],"mm":{"2":[1],"1":[2,3],"2":[4]}})");
+	dr.Deserialize(s, "s");
+	dr.Deserialize(us, "us");
+	dr.Deserialize(vb, "vb");
+	dr.Deserialize(mm, "mm");
+	TEST_CHECK(s == (std::set<std::string>{ "a", "b", "c" }));
+	TEST_CHECK(us == (std::unordered_set<int>{ 1, 2, 3 }));
+	TEST_CHECK(vb == (std::vector<bool>{ true, false, true }));
+	TEST_CHECK(mm.size() == 3 && mm.begin()->second == (std::vector<int>{ 2, 3 }) && mm.count(2) == 2);
+
+	//a duplicate key keeps its first value.
+	std::map<std::string, std::vector<int>> m;
+	std::unordered_map<int, std::string> um;
+	dr.Parse(R"({"m":{"k":[1,2],"j":[],"k":[3]},"um":{"1":"a","1":"b","2":"c"}})");
+	dr.Deserialize(m, "m");
+	dr.Deserialize(um, "um");
+	TEST_CHECK(m.size() == 2 && m["k"] == (std::vector<int>{ 1, 2 }) && m["j"].empty());
+	TEST_CHECK(um.size() == 2 && um[1] == "a" && um[2] == "c");
+}
+
+TEST_CASE(parallel_serialize_same_text)
+{
+	using namespace kapok;
+	struct item
+	{
+		int id;
+		double price;
+		std::vector<std::string> tags;
+
+		META(id, price, tags);
+	};
+
+	std::vector<item> items;
+	std::deque<double> prices;
+	std::stack<int> stack;
+	for (int i = 0; i < 3001; i++)
+	{
+		items.push_back({ i, i / 3.0, std::vector<std::string>(i % 3, "tag\"" + std::to_string(i)) });
+		prices.push_back(i * 0.1);
+		stack.push(i);
+	}
+	static int numbers[1000];
+	numbers[999] = 999;
+	auto value = std::make_tuple(items, prices, stack, std::array<int, 3>{ { 1, 2, 3 } }, std::vector<int>{ 1, 2 });
+
+	Serializer sr;
+	sr.SetDoubleFormat<precision<4>>();
+	sr.Serialize(value, "v");
+	const std::string json = sr.GetString();
+	sr.Serialize(numbers, "n");
+	const std::string array_json = sr.GetString();
+
+	//few elements per slice, more slices than elements, and the containers inside a tuple.
+	for (size_t threads : { 2, 3, 8 })
+	{
+		Serializer psr;
+		psr.SetDoubleFormat<precision<4>>();
+		psr.SetParallel(threads, 2);
+		psr.Serialize(value, "v");
+		TEST_CHECK(psr.GetString() == json);
+
+		std::ostringstream os;
+		psr.Serialize(value, "v", os);
+		TEST_CHECK(os.str() == json);
+
+		psr.Serialize(numbers, "n");
+		TEST_CHECK(psr.GetString() == array_json);
+	}
+
+	//a sink gets the elements round by round, and the trim policy releases the slices.
+	Serializer ssr;
+	ssr.SetDoubleFormat<precision<4>>();
+	ssr.SetParallel(4, 100);
+	std::ostringstream os;
+	ssr.Serialize(value, "v", os);
+	TEST_CHECK(os.str() == json);
+	TEST_CHECK(ssr.GetReservedBytes() < Serializer::stream_buffer_size + json.size() / 4);
+
+	ssr.SetTrimPolicy(1024, 256);
+	ssr.Serialize(value, "v");
+	TEST_CHECK(ssr.GetString() == json);
+	ssr.Serialize(std::vector<int>{ 1, 2 }, "n");
+	TEST_CHECK(ssr.GetReservedBytes() < 4096);
+}
+
+TEST_CASE(parallel_deserialize_same_value)
+{
+	using namespace kapok;
+	struct item
+	{
+		int id;
+		std::string name;
+		std::vector<int> codes;
+
+		META(id, name, codes);
+
+		bool operator==(const item& other) const
+		{
+			return id == other.id && name == other.name && codes == other.codes;
+		}
+	};
+
+	std::vector<item> items;
+	std::deque<double> prices;
+	for (int i = 0; i < 3001; i++)
+	{
+		items.push_back({ i, "name" + std::to_string(i), std::vector<int>(i % 3, i) });
+		prices.push_back(i * 0.5);
+	}
+	static std::array<int, 1000> numbers;
+	numbers[999] = 999;
+	auto value = std::make_tuple(items, prices, numbers);
+
+	Serializer sr;
+	sr.Serialize(value, "v");
+	const std::string json = sr.GetString();
+	sr.Serialize(items, "v");
+	const std::string items_json = sr.GetString();
+
+	for (size_t threads : { 2, 3, 8 })
+	{
+		DeSerializer dr;
+		dr.SetParallel(threads, 2);
+		dr.Parse(json);
+		decltype(value) result;
+		TEST_CHECK(dr.TryDeserialize(result, "v"));
+		TEST_CHECK(result == value);
+
+		//the first failed element is reported, the elements after it are dropped.
+		std::string broken = items_json;
+		broken.replace(broken.find("[1234]"), 6, "{}");
+		broken.replace(broken.find("[2345,2345]"), 11, "{}");
+		dr.Parse(broken);
+		std::vector<item> read;
+		TEST_CHECK(!dr.TryDeserialize(read, "v"));
+		TEST_CHECK(dr.GetError().code == ErrorCode::type_mismatch);
+		TEST_CHECK(std::string(dr.GetError().GetPath()) == "/v/1234/codes");
+		TEST_CHECK(read.size() == 1235 && read[1233].name == "name1233");
+
+		//a fixed array keeps its size, the elements after the failed one are left untouched and the
+		//failed one keeps what was read of it, as by the sequential read.
+		const char* fixed_json = R"({"a":[{"id":1},{"id":2},{"id":3,"codes":{}},{"id":4},{"id":5},{"id":6},{"id":7},{"id":8}]})";
+		dr.Parse(fixed_json);
+		item fixed[8];
+		std::array<item, 8> std_fixed;
+		for (size_t i = 0; i < 8; i++)
+		{
+			fixed[i] = { -1, "old", { 1 } };
+			std_fixed[i] = fixed[i];
+		}
+
+		TEST_CHECK(!dr.TryDeserialize(fixed, "a"));
+		TEST_CHECK(std::string(dr.GetError().GetPath()) == "/a/2/codes");
+		TEST_CHECK(!dr.TryDeserialize(std_fixed, "a"));
+		bool untouched = fixed[1].id == 2 && fixed[2].id == 3 && fixed[2].name == "old" && std_fixed[2] == fixed[2];
+		for (size_t i = 3; i < 8; i++)
+			untouched = untouched && fixed[i] == (item{ -1, "old", { 1 } }) && std_fixed[i] == fixed[i];
+
+		TEST_CHECK(untouched);
+
+		DeSerializer sequential;
+		sequential.Parse(fixed_json);
+		std::array<item, 8> sequential_read;
+		for (size_t i = 0; i < 8; i++)
+			sequential_read[i] = { -1, "old", { 1 } };
+
+		TEST_CHECK(!sequential.TryDeserialize(sequential_read, "a"));
+		TEST_CHECK(std::string(sequential.GetError().GetPath()) == std::string(dr.GetError().GetPath()));
+		TEST_CHECK(sequential_read == std_fixed);
+	}
+}
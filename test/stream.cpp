@@ -0,0 +1,403 @@
+#include "unit_test.hpp"
+#include "kapok/Kapok.hpp"
+#include <map>
+#include <sstream>
+#include <cstdio>
+#include "rapidjson/filereadstream.h"
+#include "rapidjson/istreamwrapper.h"
+
+namespace
+{
+	struct stream_person
+	{
+		std::string name;
+		int age;
+
+		META(name, age);
+	};
+
+	struct stream_record
+	{
+		int id;
+		std::string name;
+		std::vector<int> tags;
+
+		META(id, name, tags);
+	};
+
+	std::string read_file(FILE* fp)
+	{
+		std::string text;
+		std::rewind(fp);
+		char buf[4096];
+		size_t n;
+		while ((n = std::fread(buf, 1, sizeof(buf), fp)) != 0)
+			text.append(buf, n);
+
+		return text;
+	}
+}
+
+TEST_CASE(stream_serialize)
+{
+	using namespace kapok;
+	//much bigger than the stream buffer, with a string which is bigger than the buffer too.
+	std::map<std::string, std::vector<stream_person>> m;
+	for (int i = 0; i < 100; i++)
+	{
+		auto& v = m["group" + std::to_string(i)];
+		for (int j = 0; j < 100; j++)
+			v.push_back({ "person\t" + std::to_string(j), j });
+	}
+	m["big"].push_back({ std::string(Serializer::stream_buffer_size * 2, 'x') + "\"", 1 });
+
+	Serializer sr;
+	sr.Serialize(m, "m");
+	std::string json = sr.GetString();
+	TEST_CHECK(json.size() > Serializer::stream_buffer_size * 4);
+
+	std::ostringstream os;
+	sr.Serialize(m, "m", os);
+	TEST_CHECK(os.str() == json);
+
+	FILE* fp = std::tmpfile();
+	TEST_REQUIRE(fp != nullptr);
+	sr.Serialize(m, "m", fp);
+	TEST_CHECK(read_file(fp) == json);
+
+	std::fclose(fp);
+
+	fp = std::tmpfile();
+	TEST_REQUIRE(fp != nullptr);
+	sr.Serialize(m, nullptr, fileno(fp));
+	sr.Serialize(m);
+	TEST_CHECK(read_file(fp) == sr.GetString());
+	std::fclose(fp);
+
+	std::map<std::string, std::vector<stream_person>> rm;
+	DeSerializer dr;
+	dr.Parse(os.str());
+	dr.Deserialize(rm, "m");
+	TEST_CHECK(rm.size() == m.size() && rm["big"][0].name == m["big"][0].name);
+}
+
+TEST_CASE(serialize_view_release_append)
+{
+	using namespace kapok;
+	stream_person p{ "tom", 20 };
+	Serializer sr;
+	sr.Serialize(p, "p");
+	std::string json = R"({"p":{"name":"tom","age":20}})";
+	TEST_CHECK(sr.GetView() == json);
+
+	std::string released = sr.Release();
+	TEST_CHECK(released == json);
+	TEST_CHECK(sr.GetView().empty());
+	sr.Serialize(p, "p");
+	TEST_CHECK(sr.GetString() == json);
+
+	//appended to the caller buffers, which keep their capacity.
+	std::string out = "head:";
+	sr.SerializeAppend(p, "p", out);
+	TEST_CHECK(out == "head:" + json);
+
+	std::vector<char> v;
+	v.reserve(4096);
+	const char* data = v.data();
+	for (int i = 0; i < 3; i++)
+	{
+		v.clear();
+		sr.SerializeAppend(std::vector<stream_person>(10, p), nullptr, v);
+		TEST_CHECK(v.data() == data);
+	}
+	sr.Serialize(std::vector<stream_person>(10, p));
+	TEST_CHECK(std::string(v.begin(), v.end()) == sr.GetString());
+}
+
+TEST_CASE(deserialize_reuse_document_pool)
+{
+	using namespace kapok;
+	stream_person p{ "tom", 20 };
+	Serializer sr;
+	sr.Serialize(p, "p");
+	std::string small = sr.GetString();
+	sr.Serialize(std::vector<stream_person>(2000, p), "p");
+	std::string big = sr.GetString();
+
+	char stack[2048];
+	DeSerializer dr;
+	dr.SetArena(16 * 1024, 4096);
+	dr.SetStackBuffer(stack, sizeof(stack));
+	stream_person rp;
+	dr.Parse(small);
+	const size_t capacity = dr.GetDocument().GetAllocator().Capacity();
+	for (int i = 0; i < 1000; i++)
+	{
+		dr.Parse(small);
+		dr.Deserialize(rp, "p");
+	}
+	TEST_CHECK(rp.name == "tom" && rp.age == 20);
+	TEST_CHECK(dr.GetDocument().GetAllocator().Capacity() == capacity);
+	TEST_CHECK(dr.GetDocument().GetStackCapacity() <= sizeof(stack));
+
+	//a larger message grows the pool until the next message.
+	std::vector<stream_person> v;
+	dr.Parse(big);
+	dr.Deserialize(v, "p");
+	TEST_CHECK(v.size() == 2000 && v.back().name == "tom");
+	TEST_CHECK(dr.GetDocument().GetAllocator().Capacity() > capacity);
+	dr.Parse(small);
+	TEST_CHECK(dr.GetDocument().GetAllocator().Capacity() == capacity);
+
+	dr.Reset();
+	TEST_CHECK(dr.GetDocument().IsNull());
+	dr.SetStackBuffer(nullptr, 0);
+	std::vector<stream_person> w;
+	dr.Parse(big);
+	dr.Deserialize(w, "p");
+	TEST_CHECK(w.size() == 2000);
+}
+
+TEST_CASE(trim_policy_reserved_bytes)
+{
+	using namespace kapok;
+	stream_person p{ "tom", 20 };
+	std::vector<stream_person> big(20000, p);
+	Serializer sr;
+	sr.SetTrimPolicy(64 * 1024, 4096);
+	sr.Serialize(p, "p");
+	std::string small = sr.GetString();
+	const size_t reserved = sr.GetReservedBytes();
+	TEST_CHECK(reserved < 64 * 1024);
+
+	sr.Serialize(big, "p");
+	std::string large = sr.GetString();
+	TEST_CHECK(sr.GetReservedBytes() >= large.size());
+	sr.Serialize(p, "p");
+	TEST_CHECK(sr.GetString() == small);
+	TEST_CHECK(sr.GetReservedBytes() < 64 * 1024);
+
+	sr.Serialize(big, "p");
+	sr.Trim();
+	TEST_CHECK(sr.GetReservedBytes() < 64 * 1024);
+	TEST_CHECK(sr.GetView().empty());
+
+	DeSerializer dr;
+	dr.SetArena(16 * 1024, 4096);
+	dr.SetTrimPolicy(64 * 1024, 4096);
+	stream_person rp;
+	dr.Parse(small);
+	const size_t parse_reserved = dr.GetReservedBytes();
+	TEST_CHECK(parse_reserved < 64 * 1024);
+
+	std::vector<stream_person> v;
+	dr.Parse(large);
+	dr.Deserialize(v, "p");
+	TEST_CHECK(v.size() == big.size());
+	TEST_CHECK(dr.GetReservedBytes() > large.size());
+	dr.Parse(small);
+	dr.Deserialize(rp, "p");
+	TEST_CHECK(rp.name == "tom");
+	TEST_CHECK(dr.GetReservedBytes() <= parse_reserved + 4096);
+
+	dr.Parse(large);
+	dr.Trim();
+	TEST_CHECK(dr.GetReservedBytes() < 64 * 1024);
+	dr.Parse(small);
+	dr.Deserialize(rp, "p");
+	TEST_CHECK(rp.age == 20);
+}
+
+TEST_CASE(parse_copy_read_only)
+{
+	using namespace kapok;
+	std::vector<int> numbers(100000, 123456);
+	Serializer sr;
+	sr.Serialize(numbers, "n");
+	const std::string json = sr.GetString();
+
+	//the same document, the in-place parse of Parse also keeps its copy of the text.
+	DeSerializer copy;
+	copy.Parse(json);
+	DeSerializer dr;
+	dr.ParseCopy(json.data(), json.size());
+	std::vector<int> read;
+	dr.Deserialize(read, "n");
+	TEST_CHECK(read == numbers);
+	TEST_CHECK(dr.GetReservedBytes() + json.size() <= copy.GetReservedBytes());
+
+	stream_person p;
+	const std::string person = R"({"p":{"name":"t\"om","age":20}})";
+	dr.ParseCopy(person.data(), person.size());
+	dr.Deserialize(p, "p");
+	TEST_CHECK(p.name == "t\"om" && p.age == 20);
+	TEST_CHECK(!dr.TryParseCopy(person.data(), person.size() - 1));
+	TEST_CHECK(dr.GetError().code == ErrorCode::parse_error);
+}
+
+TEST_CASE(for_each_array_element)
+{
+	using namespace kapok;
+	std::vector<stream_record> records;
+	for (int i = 0; i < 1000; i++)
+		records.push_back({ i, "record" + std::to_string(i), std::vector<int>(i % 3, i) });
+
+	Serializer sr;
+	sr.Serialize(records, "records");
+	std::string json = sr.GetString();
+
+	//every element is read into the same cleared record.
+	FILE* fp = std::tmpfile();
+	TEST_REQUIRE(fp != nullptr);
+	std::fwrite(json.data(), 1, json.size(), fp);
+	std::rewind(fp);
+	char buffer[256];
+	rapidjson::FileReadStream fs(fp, buffer, sizeof(buffer));
+	size_t count = 0;
+	const stream_record* last = nullptr;
+	bool same = true;
+	for_each<stream_record>(fs, "records", [&](stream_record& r)
+	{
+		same = same && r.id == records[count].id && r.name == records[count].name && r.tags == records[count].tags;
+		same = same && (last == nullptr || last == &r);
+		last = &r;
+		count++;
+	});
+	std::fclose(fp);
+	TEST_CHECK(count == records.size() && same);
+
+	sr.Serialize(records);
+	std::istringstream in(sr.GetString());
+	rapidjson::IStreamWrapper is(in);
+	count = 0;
+	for_each<stream_record>(is, [&](stream_record& r) { count += r.id == records[count].id; });
+	TEST_CHECK(count == records.size());
+
+	rapidjson::StringStream ss(R"({"records":[1,2,3]})");
+	int sum = 0;
+	for_each<int>(ss, "records", [&](int& i) { sum += i; });
+	TEST_CHECK(sum == 6);
+
+	//the adaptors of an element are emptied through their container.
+	struct queued
+	{
+		int id;
+		std::queue<int> q;
+		std::stack<int> s;
+		std::priority_queue<int> pq;
+
+		META(id, q, s, pq);
+	};
+
+	rapidjson::StringStream queues(R"([{"id":1,"q":[1,2],"s":[2,1],"pq":[2,1]},{"id":2,"q":[3],"s":[3],"pq":[3]},{"id":3}])");
+	std::vector<size_t> sizes;
+	for_each<queued>(queues, [&](queued& e) { sizes.push_back(e.q.size() + e.s.size() + e.pq.size()); });
+	TEST_CHECK(sizes == (std::vector<size_t>{ 6, 3, 0 }));
+
+	SaxDeSerializer dr;
+	rapidjson::StringStream bad(R"({"records":{"id":1}})");
+	TEST_CHECK(!dr.TryForEach<stream_record>(bad, "records", [](stream_record&) {}));
+	TEST_CHECK(dr.GetError().code == ErrorCode::type_mismatch);
+}
+
+TEST_CASE(parse_ndjson_in_order)
+{
+	using namespace kapok;
+	std::string ndjson;
+	Serializer sr;
+	for (int i = 0; i < 5000; i++)
+	{
+		sr.Serialize(stream_record{ i, "record" + std::to_string(i), std::vector<int>(i % 3, i) });
+		ndjson += sr.GetString();
+		ndjson += i % 7 == 0 ? "\r\n\n" : "\n";
+	}
+
+	for (size_t threads : { 1, 4 })
+	{
+		std::vector<stream_record> records = parse_ndjson<stream_record>(ndjson, threads);
+		TEST_REQUIRE(records.size() == 5000);
+		bool same = true;
+		for (int i = 0; i < 5000; i++)
+			same = same && records[i].id == i && records[i].name == "record" + std::to_string(i) && records[i].tags.size() == size_t(i % 3);
+
+		TEST_CHECK(same);
+	}
+
+	//the records before a bad line are handed over, the offset is in the whole buffer.
+	const size_t bad = ndjson.find("{\"id\":4000");
+	std::string broken = ndjson;
+	broken[bad] = '[';
+	int count = 0;
+	Error error;
+	TEST_CHECK(!try_parse_ndjson<stream_record>(broken.c_str(), broken.size(), 4, [&count](stream_record&& r) { count += r.id == count; }, error));
+	TEST_CHECK(count == 4000);
+	TEST_CHECK(error.code == ErrorCode::type_mismatch && error.offset == bad + 1);
+
+	//a pool kept by the caller decodes several buffers, a failed one included.
+	ThreadPool pool(3);
+	for (const std::string* text : { &ndjson, &broken, &ndjson })
+	{
+		count = 0;
+		bool ok = try_parse_ndjson<stream_record>(text->c_str(), text->size(), pool, [&count](stream_record&& r) { count += r.id == count; }, error);
+		TEST_CHECK(ok == (text == &ndjson) && count == (ok ? 5000 : 4000));
+	}
+}
+
+TEST_CASE(parse_mapped_file)
+{
+	using namespace kapok;
+	std::vector<stream_record> records;
+	for (int i = 0; i < 1000; i++)
+		records.push_back({ i, "record\t" + std::to_string(i), std::vector<int>(i % 3, i) });
+
+	Serializer sr;
+	sr.Serialize(records, "records");
+	const std::string json = sr.GetString();
+
+	const char* path = "kapok_parse_mapped_file.json";
+	FILE* fp = std::fopen(path, "wb");
+	TEST_REQUIRE(fp != nullptr);
+	std::fwrite(json.data(), 1, json.size(), fp);
+	std::fclose(fp);
+
+	DeSerializer dr;
+	std::vector<stream_record> read;
+	dr.ParseFile(path);
+	dr.Deserialize(read, "records");
+	TEST_CHECK(read.size() == records.size() && read[999].name == records[999].name && read[998].tags == records[998].tags);
+
+	//the mapping is parsed without a copy of the text, unlike Parse of the same json.
+	DeSerializer copy;
+	copy.Parse(json);
+	TEST_CHECK(dr.GetReservedBytes() + json.size() <= copy.GetReservedBytes());
+
+	//the escapes are decoded in the private mapping, the views point there and the file is unchanged.
+	struct named
+	{
+		int id;
+		boost::string_ref name;
+
+		META(id, name);
+	};
+
+	std::vector<named> views;
+	dr.ParseFileInsitu(path);
+	dr.Deserialize(views, "records");
+	TEST_CHECK(views.size() == records.size() && views[12].name == "record\t12");
+	fp = std::fopen(path, "rb");
+	TEST_REQUIRE(fp != nullptr);
+	TEST_CHECK(read_file(fp) == json);
+	std::fclose(fp);
+
+	fp = std::fopen(path, "wb");
+	TEST_REQUIRE(fp != nullptr);
+	std::fputs(R"({"records":[{"id":1},])", fp);
+	std::fclose(fp);
+	TEST_CHECK(!dr.TryParseFile(path));
+	TEST_CHECK(dr.GetError().code == ErrorCode::parse_error && dr.GetError().offset == 21);
+	std::remove(path);
+
+	TEST_CHECK(!dr.TryParseFileInsitu(path));
+	TEST_CHECK(dr.GetError().code == ErrorCode::file_error);
+	TEST_CHECK(!dr.TryDeserialize(read, "records"));
+}
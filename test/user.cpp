@@ -49,6 +49,43 @@ TEST_CASE(user_type_with_string)
     TEST_CHECK(t.b == "str2");    
 }
 
+TEST_CASE(user_type_with_string_ref)
+{
+	using namespace kapok;
+	struct T
+	{
+		boost::string_ref path;
+		boost::string_ref method;
+		std::map<boost::string_ref, int> weights;
+		int id;
+
+		META(path, method, weights, id);
+	};
+
+	//no '\0' after the text, the buffer is parsed up to its length.
+	const std::string json = R"({"T":{"path":"/api/v1","method":"P\"OST","weights":{"a":1,"b\n":2},"id":7}})";
+	std::vector<char> buf(json.begin(), json.end());
+	DeSerializer dr;
+	dr.ParseInsitu(buf.data(), buf.size());
+	T t;
+	dr.Deserialize(t, "T");
+	TEST_CHECK(t.path == "/api/v1");
+	TEST_CHECK(t.method == "P\"OST");
+	TEST_CHECK(t.weights.size() == 2 && t.weights["a"] == 1 && t.weights["b\n"] == 2);
+	TEST_CHECK(t.id == 7);
+	TEST_CHECK(t.path.data() > buf.data() && t.path.data() < buf.data() + buf.size());
+
+	Serializer sr;
+	sr.Serialize(t, "T");
+	TEST_CHECK(sr.GetString() == json);
+
+	T s;
+	SaxDeSerializer sdr;
+	sdr.Deserialize(s, json, "T");
+	TEST_CHECK(s.method == "P\"OST" && s.weights.size() == 2 && s.id == 7);
+	TEST_CHECK(s.path == "/api/v1" && s.weights["a"] == 1 && s.weights["b\n"] == 2);
+}
+
 TEST_CASE(user_type_with_container)
 {
 	using namespace kapok;
@@ -77,3 +114,198 @@ TEST_CASE(user_type_with_container)
     TEST_CHECK(t.b == (std::set<int>{1, 2, 3, 4, 5}));
     TEST_CHECK(t.c == (std::vector<std::string>{"1", "2", "3", "4", "5"}));
 }
+
+TEST_CASE(user_type_field_lookup)
+{
+	using namespace kapok;
+	struct T
+	{
+		int f0, f1, f2, f3, f4, f5, f6, f7, f8, f9;
+		int g0, g1, g2, g3, g4, g5, g6, g7, g8, g9;
+		std::string name;
+
+		META(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, g0, g1, g2, g3, g4, g5, g6, g7, g8, g9, name);
+	};
+
+	for (size_t i = 0; i < field_table<T>::size; i++)
+	{
+		const char* name = field_table<T>::names[i];
+		TEST_CHECK(field_table<T>::find(name, strlen(name)) == i);
+	}
+	TEST_CHECK(field_table<T>::find("f", 1) == field_table<T>::npos);
+	TEST_CHECK(field_table<T>::find("f00", 3) == field_table<T>::npos);
+
+	DeSerializer dr;
+	dr.Parse(R"({"T":{"g9":9,"unknown":[1,2],"name":"t","f0":10,"f1":11,"g0":20}})");
+	T t{};
+	dr.Deserialize(t, "T");
+	TEST_CHECK(t.f0 == 10);
+	TEST_CHECK(t.f1 == 11);
+	TEST_CHECK(t.g0 == 20);
+	TEST_CHECK(t.g9 == 9);
+	TEST_CHECK(t.f5 == 0);
+	TEST_CHECK(t.name == "t");
+}
+
+TEST_CASE(user_type_duplicate_keys)
+{
+	using namespace kapok;
+	struct T
+	{
+		int id;
+		std::vector<int> tags;
+		std::string name;
+
+		META(id, tags, name);
+	};
+
+	//the first value of a repeated key is read, as by FindMember.
+	DeSerializer dr;
+	dr.Parse(R"({"T":{"id":1,"tags":[1,2],"id":2,"name":"a","tags":[3],"name":"b"}})");
+	T t{};
+	dr.Deserialize(t, "T");
+	TEST_CHECK(t.id == 1);
+	TEST_CHECK(t.tags == (std::vector<int>{ 1, 2 }));
+	TEST_CHECK(t.name == "a");
+}
+
+TEST_CASE(user_type_key_fragments)
+{
+	using namespace kapok;
+	struct T
+	{
+		int id;
+		std::string name;
+		std::vector<int> v;
+
+		META(id, name, v);
+	};
+
+	TEST_CHECK(key_fragments<T>::size == 3);
+	TEST_CHECK(std::string(key_fragments<T>::data(0), key_fragments<T>::length_of(0)) == "\"id\":");
+	TEST_CHECK(std::string(key_fragments<T>::data(1), key_fragments<T>::length_of(1)) == ",\"name\":");
+	TEST_CHECK(std::string(key_fragments<T>::data(2), key_fragments<T>::length_of(2)) == ",\"v\":");
+
+	Serializer sr;
+	sr.Serialize(T{ 1, "a", { 2, 3 } }, "T");
+	TEST_CHECK(std::string(sr.GetString()) == R"({"T":{"id":1,"name":"a","v":[2,3]}})");
+}
+
+TEST_CASE(user_type_with_120_fields)
+{
+	using namespace kapok;
+	struct T
+	{
+		int f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19;
+		int f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30, f31, f32, f33, f34, f35, f36, f37, f38, f39;
+		int f40, f41, f42, f43, f44, f45, f46, f47, f48, f49, f50, f51, f52, f53, f54, f55, f56, f57, f58, f59;
+		int f60, f61, f62, f63, f64, f65, f66, f67, f68, f69, f70, f71, f72, f73, f74, f75, f76, f77, f78, f79;
+		int f80, f81, f82, f83, f84, f85, f86, f87, f88, f89, f90, f91, f92, f93, f94, f95, f96, f97, f98, f99;
+		int f100, f101, f102, f103, f104, f105, f106, f107, f108, f109, f110, f111, f112, f113, f114, f115, f116, f117, f118, f119;
+
+		META(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19,
+			f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30, f31, f32, f33, f34, f35, f36, f37, f38, f39,
+			f40, f41, f42, f43, f44, f45, f46, f47, f48, f49, f50, f51, f52, f53, f54, f55, f56, f57, f58, f59,
+			f60, f61, f62, f63, f64, f65, f66, f67, f68, f69, f70, f71, f72, f73, f74, f75, f76, f77, f78, f79,
+			f80, f81, f82, f83, f84, f85, f86, f87, f88, f89, f90, f91, f92, f93, f94, f95, f96, f97, f98, f99,
+			f100, f101, f102, f103, f104, f105, f106, f107, f108, f109, f110, f111, f112, f113, f114, f115, f116, f117, f118, f119);
+	};
+
+	T t{};
+	t.f0 = 1;
+	t.f63 = 64;
+	t.f119 = 120;
+
+	Serializer sr;
+	sr.Serialize(t, "T");
+
+	T r{};
+	DeSerializer dr;
+	dr.Parse(sr.GetString());
+	dr.Deserialize(r, "T");
+	TEST_CHECK(r.f0 == 1);
+	TEST_CHECK(r.f63 == 64);
+	TEST_CHECK(r.f119 == 120);
+
+	T s{};
+	SaxDeSerializer sdr;
+	sdr.Deserialize(s, sr.GetString(), "T");
+	TEST_CHECK(s.f0 == 1);
+	TEST_CHECK(s.f63 == 64);
+	TEST_CHECK(s.f119 == 120);
+}
+
+TEST_CASE(user_type_with_variant_and_optional)
+{
+	using namespace kapok;
+	struct T
+	{
+		variant<int, std::string, std::vector<int>> a;
+		boost::optional<std::vector<std::string>> b;
+		std::vector<variant<std::string, double>> c;
+
+		META(a, b, c);
+	};
+
+	T src;
+	src.a = std::vector<int>{ 1, 2 };
+	src.b = std::vector<std::string>{ "x", "y" };
+	src.c.resize(2);
+	src.c[0] = std::string("s");
+	src.c[1] = 0.5;
+	Serializer sr;
+	sr.Serialize(src, "T");
+	std::string json = R"({"T":{"a":{"2":[1,2]},"b":["x","y"],"c":[{"0":"s"},{"1":0.5}]}})";
+	TEST_CHECK(sr.GetString() == json);
+
+	//the alternative and the optional are constructed again, the old values are not appended to.
+	T t;
+	t.a = std::vector<int>{ 9 };
+	t.b = std::vector<std::string>{ "old" };
+	DeSerializer dr;
+	dr.Parse(json);
+	dr.Deserialize(t, "T");
+	TEST_CHECK(t.a == src.a && t.b == src.b && t.c == src.c);
+
+	T st;
+	st.a = std::vector<int>{ 9 };
+	SaxDeSerializer sdr;
+	sdr.Deserialize(st, json, "T");
+	TEST_CHECK(st.a == src.a && st.b == src.b && st.c == src.c);
+
+	bool flag = false;
+	try
+	{
+		dr.Parse(R"({"T":{"a":{"3":1}}})");
+		dr.Deserialize(t, "T");
+	}
+	catch (const std::invalid_argument&)
+	{
+		flag = true;
+	}
+	TEST_CHECK(flag);
+
+#ifdef KAPOK_HAS_STD_VARIANT
+	struct S
+	{
+		std::variant<int, std::string, std::vector<int>> a;
+		std::optional<std::vector<std::string>> b;
+		std::vector<std::variant<std::string, double>> c;
+
+		META(a, b, c);
+	};
+
+	S s{ std::vector<int>{ 1, 2 }, std::vector<std::string>{ "x", "y" }, { std::string("s"), 0.5 } };
+	sr.Serialize(s, "T");
+	TEST_CHECK(sr.GetString() == json);
+
+	S rs{ std::vector<int>{ 9 }, std::vector<std::string>{ "old" }, {} };
+	dr.Parse(json);
+	dr.Deserialize(rs, "T");
+	TEST_CHECK(rs.a == s.a && rs.b == s.b && rs.c == s.c);
+
+	S srs{};
+	sdr.Deserialize(srs, json, "T");
+	TEST_CHECK(srs.a == s.a && srs.b == s.b && srs.c == s.c);
+#endif
+}
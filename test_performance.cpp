@@ -2,6 +2,9 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <map>
+#include <cmath>
+#include <cstdio>
 #include <boost/timer.hpp>
 #include <kapok/Kapok.hpp>
 #include <fmt/format.h>
@@ -71,6 +74,664 @@ void test_kapok()
 	std::cout << tm.elapsed() << std::endl;
 }
 
+void test_kapok_sax()
+{
+	my_person p = { "test", 20 };
+
+	kapok::Serializer sr;
+	sr.Serialize(p);
+	std::string json = sr.GetString();
+
+	boost::timer tm;
+	my_person rp;
+	kapok::SaxDeSerializer dr;
+	for (size_t i = 0; i < MAXSIZE; i++)
+	{
+		dr.Deserialize(rp, json.c_str(), json.length());
+	}
+	std::cout << tm.elapsed() << " sax" << std::endl;
+}
+
+struct wide_record
+{
+	int a0, a1, a2, a3, a4, a5, a6, a7, a8, a9;
+	int b0, b1, b2, b3, b4, b5, b6, b7, b8, b9;
+	int c0, c1, c2, c3, c4, c5, c6, c7, c8, c9;
+	std::string name, type;
+
+	META(a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, b0, b1, b2, b3, b4, b5, b6, b7, b8, b9,
+		c0, c1, c2, c3, c4, c5, c6, c7, c8, c9, name, type);
+};
+
+//build with -DKAPOK_LINEAR_FIELD_LOOKUP to compare with the FindMember lookup.
+void test_kapok_field_lookup()
+{
+	wide_record w = {};
+	kapok::Serializer sr;
+	sr.Serialize(w);
+
+	kapok::DeSerializer dr;
+	dr.Parse(sr.GetString());
+	wide_record rw;
+	boost::timer tm;
+	for (size_t i = 0; i < MAXSIZE / 10; i++)
+	{
+		dr.Deserialize(rw);
+	}
+	std::cout << tm.elapsed() << " field lookup" << std::endl;
+}
+
+#define FIELDS_10(p) p##0, p##1, p##2, p##3, p##4, p##5, p##6, p##7, p##8, p##9
+#define FIELDS_30(p) FIELDS_10(p##0), FIELDS_10(p##1), FIELDS_10(p##2)
+
+struct record_30 { int FIELDS_30(a); META(FIELDS_30(a)); };
+struct record_60 { int FIELDS_30(a), FIELDS_30(b); META(FIELDS_30(a), FIELDS_30(b)); };
+struct record_120 { int FIELDS_30(a), FIELDS_30(b), FIELDS_30(c), FIELDS_30(d); META(FIELDS_30(a), FIELDS_30(b), FIELDS_30(c), FIELDS_30(d)); };
+
+template<typename T>
+void test_kapok_field_count(size_t count)
+{
+	T t = {};
+	kapok::Serializer sr;
+	sr.Serialize(t);
+
+	kapok::DeSerializer dr;
+	dr.Parse(sr.GetString());
+	T rt;
+	boost::timer tm;
+	for (size_t i = 0; i < MAXSIZE / 10; i++)
+	{
+		dr.Deserialize(rt);
+	}
+	double elapsed = tm.elapsed();
+	std::cout << count << " fields: " << elapsed << " " << elapsed / count << " per field" << std::endl;
+}
+
+//the decode time should grow linearly with the field count.
+void test_kapok_wide_record()
+{
+	test_kapok_field_count<record_30>(30);
+	test_kapok_field_count<record_60>(60);
+	test_kapok_field_count<record_120>(120);
+}
+
+void test_kapok_int_map()
+{
+	std::map<int, my_person> m;
+	for (int i = 0; i < 100; i++)
+		m.emplace(i * 1000, my_person{ "test", i });
+
+	kapok::Serializer sr;
+	boost::timer tm;
+	for (size_t i = 0; i < MAXSIZE / 100; i++)
+	{
+		sr.Serialize(m);
+	}
+	std::cout << tm.elapsed() << " ";
+
+	std::map<int, my_person> rm;
+	kapok::DeSerializer dr;
+	dr.Parse(sr.GetString());
+	tm.restart();
+	for (size_t i = 0; i < MAXSIZE / 100; i++)
+	{
+		rm.clear();
+		dr.Deserialize(rm);
+	}
+	std::cout << tm.elapsed() << " int map" << std::endl;
+}
+
+void test_kapok_nested_containers()
+{
+	std::vector<std::map<std::string, std::vector<my_person>>> v(20);
+	for (auto& m : v)
+	{
+		for (int i = 0; i < 50; i++)
+			m.emplace("group" + std::to_string(i), std::vector<my_person>(20, my_person{ "a person with a long name", i }));
+	}
+
+	kapok::Serializer sr;
+	sr.Serialize(v);
+	kapok::DeSerializer dr;
+	dr.Parse(sr.GetString());
+	boost::timer tm;
+	for (size_t i = 0; i < MAXSIZE / 10000; i++)
+	{
+		std::vector<std::map<std::string, std::vector<my_person>>> rv;
+		dr.Deserialize(rv);
+	}
+	std::cout << tm.elapsed() << " nested containers" << std::endl;
+}
+
+void test_kapok_variant()
+{
+	std::vector<kapok::variant<int, std::string, my_person>> v(10000);
+	for (size_t i = 0; i < v.size(); i++)
+	{
+		if (i % 3 == 0)
+			v[i] = static_cast<int>(i);
+		else if (i % 3 == 1)
+			v[i] = std::string("value");
+		else
+			v[i] = my_person{ "test", static_cast<int>(i) };
+	}
+
+	kapok::Serializer sr;
+	boost::timer tm;
+	for (size_t i = 0; i < MAXSIZE / 1000; i++)
+	{
+		sr.Serialize(v);
+	}
+	std::cout << tm.elapsed() << " ";
+
+	kapok::DeSerializer dr;
+	dr.Parse(sr.GetString());
+	tm.restart();
+	for (size_t i = 0; i < MAXSIZE / 1000; i++)
+	{
+		std::vector<kapok::variant<int, std::string, my_person>> rv;
+		dr.Deserialize(rv);
+	}
+	std::cout << tm.elapsed() << " variant" << std::endl;
+}
+
+//snapshot of a big pending queue.
+void test_kapok_priority_queue()
+{
+	std::priority_queue<int> pq;
+	for (int i = 0; i < 50000; i++)
+		pq.push(i * 7919 % 50000);
+
+	kapok::Serializer sr;
+	boost::timer tm;
+	for (size_t i = 0; i < MAXSIZE / 10000; i++)
+	{
+		sr.Serialize(pq);
+	}
+	std::cout << tm.elapsed() << " ";
+
+	kapok::DeSerializer dr;
+	dr.Parse(sr.GetString());
+	tm.restart();
+	for (size_t i = 0; i < MAXSIZE / 10000; i++)
+	{
+		std::priority_queue<int> rpq;
+		dr.Deserialize(rpq);
+	}
+	std::cout << tm.elapsed() << " priority_queue" << std::endl;
+}
+
+template<typename T>
+void test_kapok_float_vector(const std::vector<T>& v, const char* name)
+{
+	kapok::Serializer sr;
+	boost::timer tm;
+	for (size_t i = 0; i < MAXSIZE / 1000; i++)
+	{
+		sr.Serialize(v);
+	}
+	double elapsed = tm.elapsed();
+	size_t length = strlen(sr.GetString());
+
+	std::vector<T> rv;
+	kapok::DeSerializer dr;
+	dr.Parse(sr.GetString());
+	tm.restart();
+	for (size_t i = 0; i < MAXSIZE / 1000; i++)
+	{
+		rv.clear();
+		dr.Deserialize(rv);
+	}
+	std::cout << name << ": " << length << " bytes, serialize " << elapsed << " deserialize " << tm.elapsed() << std::endl;
+}
+
+//sensor readings, floats written with their own shortest digits against the old widening to double.
+void test_kapok_float()
+{
+	std::vector<float> v;
+	for (int i = 0; i < 10000; i++)
+		v.push_back(static_cast<float>(std::sin(i * 0.001) * 100.0));
+
+	test_kapok_float_vector(v, "float");
+	test_kapok_float_vector(std::vector<double>(v.begin(), v.end()), "float widened to double");
+}
+
+template<typename Format>
+void test_kapok_double_format(const std::vector<std::vector<std::array<double, 2>>>& polygons, const char* name)
+{
+	kapok::Serializer sr;
+	sr.SetDoubleFormat<Format>();
+	boost::timer tm;
+	for (size_t i = 0; i < MAXSIZE / 100000; i++)
+	{
+		sr.Serialize(polygons);
+	}
+	double elapsed = tm.elapsed();
+
+	std::vector<std::vector<std::array<double, 2>>> rv;
+	kapok::DeSerializer dr;
+	tm.restart();
+	for (size_t i = 0; i < MAXSIZE / 100000; i++)
+	{
+		dr.Parse(sr.GetString());
+		dr.Deserialize(rv);
+	}
+	double dom = tm.elapsed();
+
+	kapok::SaxDeSerializer sax;
+	std::string json = sr.GetString();
+	tm.restart();
+	for (size_t i = 0; i < MAXSIZE / 100000; i++)
+	{
+		sax.Deserialize(rv, json);
+	}
+	std::cout << name << ": " << json.size() << " bytes, serialize " << elapsed << " deserialize " << dom << " sax " << tm.elapsed() << std::endl;
+}
+
+//the parse alone of number-heavy text: kapok reads each number once from its text, rapidjson
+//with the default flags may be an ulp off, with kParseFullPrecisionFlag it is exact.
+void test_kapok_parse_numbers(const std::vector<std::vector<std::array<double, 2>>>& polygons)
+{
+	kapok::Serializer sr;
+	sr.Serialize(polygons);
+	std::string json = sr.GetString();
+
+	kapok::DeSerializer dr;
+	boost::timer tm;
+	for (size_t i = 0; i < MAXSIZE / 100000; i++)
+	{
+		dr.Parse(json);
+	}
+	double kapok_parse = tm.elapsed();
+
+	rapidjson::Document doc;
+	tm.restart();
+	for (size_t i = 0; i < MAXSIZE / 100000; i++)
+	{
+		doc.Parse(json.c_str(), json.size());
+	}
+	double default_flags = tm.elapsed();
+
+	tm.restart();
+	for (size_t i = 0; i < MAXSIZE / 100000; i++)
+	{
+		doc.Parse<rapidjson::kParseFullPrecisionFlag>(json.c_str(), json.size());
+	}
+	std::cout << "parse: kapok " << kapok_parse << " rapidjson " << default_flags << " full precision " << tm.elapsed() << std::endl;
+}
+
+//canada.json style coordinates, full precision longitudes and latitudes.
+void test_kapok_coordinates()
+{
+	std::vector<std::vector<std::array<double, 2>>> polygons(480);
+	double x = -141.0;
+	double y = 41.0;
+	for (auto& polygon : polygons)
+	{
+		for (int i = 0; i < 232; i++)
+		{
+			x = -141.0 + std::fmod(x + 141.0 + 0.0123456789012345, 89.0);
+			y = 41.0 + std::fmod(y - 41.0 + 0.0098765432109876, 42.0);
+			polygon.push_back({ { x, y } });
+		}
+	}
+
+	test_kapok_double_format<kapok::grisu2>(polygons, "grisu2");
+	test_kapok_double_format<kapok::shortest>(polygons, "shortest");
+	test_kapok_double_format<kapok::precision<6>>(polygons, "precision<6>");
+	test_kapok_parse_numbers(polygons);
+}
+
+template<typename Format>
+void test_kapok_double_vector(const std::vector<double>& v, const char* name)
+{
+	kapok::Serializer sr;
+	sr.SetDoubleFormat<Format>();
+	boost::timer tm;
+	for (size_t i = 0; i < MAXSIZE / 10000; i++)
+	{
+		sr.Serialize(v);
+	}
+	std::cout << name << ": serialize " << tm.elapsed() << std::endl;
+}
+
+//the doubles grisu3 can't decide, shortest writes all of them with the exact big integer fallback.
+void test_kapok_double_fallback()
+{
+	std::vector<double> v;
+	uint64_t bits = 0;
+	while (v.size() < 10000)
+	{
+		bits = bits * 6364136223846793005ULL + 1442695040888963407ULL;
+		const uint64_t positive = bits & 0x7FFFFFFFFFFFFFFFULL;
+		double d;
+		std::memcpy(&d, &positive, sizeof(d));
+		char buffer[32];
+		int length, K;
+		if (std::isfinite(d) && d != 0 && !kapok::detail::grisu3(d, buffer, &length, &K))
+			v.push_back(d);
+	}
+
+	test_kapok_double_vector<kapok::grisu2>(v, "grisu3 fallback, grisu2");
+	test_kapok_double_vector<kapok::shortest>(v, "grisu3 fallback, shortest");
+}
+
+struct route_request
+{
+	std::string method, path, host, user_agent, body;
+	META(method, path, host, user_agent, body);
+};
+
+struct route_request_view
+{
+	boost::string_ref method, path, host, user_agent, body;
+	META(method, path, host, user_agent, body);
+};
+
+//a router reading a few strings: copies into std::string against views into the parsed buffer.
+void test_kapok_insitu()
+{
+	route_request r = { "POST", "/api/v1/orders/checkout", "shop.example.com",
+		"Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)", std::string(200, 'x') };
+	kapok::Serializer sr;
+	sr.Serialize(r);
+	std::string json = sr.GetString();
+
+	kapok::DeSerializer dr;
+	boost::timer tm;
+	for (size_t i = 0; i < MAXSIZE; i++)
+	{
+		route_request rr;
+		dr.Parse(json);
+		dr.Deserialize(rr);
+	}
+	double elapsed = tm.elapsed();
+
+	std::vector<char> buf(json.size());
+	tm.restart();
+	for (size_t i = 0; i < MAXSIZE; i++)
+	{
+		route_request_view rv;
+		std::memcpy(buf.data(), json.data(), json.size());
+		dr.ParseInsitu(buf.data(), buf.size());
+		dr.Deserialize(rv);
+	}
+	std::cout << "std::string " << elapsed << " insitu string_ref " << tm.elapsed() << std::endl;
+}
+
+struct order_line
+{
+	int sku;
+	double price;
+	std::string note;
+
+	META(sku, price, note);
+};
+
+struct order_message
+{
+	int id;
+	std::string type;
+	std::vector<order_line> lines;
+
+	META(id, type, lines);
+};
+
+struct order_envelope
+{
+	int id;
+	std::string type;
+
+	META(id, type);
+};
+
+//the envelope of a message of about 1MB: the whole document against skipping the lines unread.
+void test_kapok_projection()
+{
+	order_message m = { 42, "order" };
+	for (int i = 0; i < 20000; i++)
+		m.lines.push_back(order_line{ i, i * 0.25, "line note with \"quotes\" and [brackets]" });
+
+	kapok::Serializer sr;
+	sr.Serialize(m);
+	std::string json = sr.GetString();
+
+	kapok::DeSerializer dr;
+	boost::timer tm;
+	for (size_t i = 0; i < MAXSIZE / 10000; i++)
+	{
+		order_envelope e;
+		dr.Parse(json);
+		dr.Deserialize(e);
+	}
+	double dom = tm.elapsed();
+
+	kapok::SaxDeSerializer sax;
+	tm.restart();
+	for (size_t i = 0; i < MAXSIZE / 10000; i++)
+	{
+		order_envelope e;
+		sax.Deserialize(e, json.c_str(), json.length());
+	}
+	double elapsed = tm.elapsed();
+
+	kapok::ProjectionDeSerializer pr;
+	tm.restart();
+	for (size_t i = 0; i < MAXSIZE / 10000; i++)
+	{
+		order_envelope e;
+		pr.Deserialize(e, json.c_str(), json.length());
+	}
+	std::cout << "dom " << dom << " sax " << elapsed << " projection " << tm.elapsed() << std::endl;
+}
+
+//an import file of 200000 records: the whole vector against one record at a time.
+void test_kapok_for_each()
+{
+	std::vector<order_line> lines;
+	for (int i = 0; i < 200000; i++)
+		lines.push_back(order_line{ i, i * 0.25, "imported line" });
+
+	kapok::Serializer sr;
+	sr.Serialize(lines, "lines");
+	std::string json = sr.GetString();
+
+	boost::timer tm;
+	double total = 0;
+	for (size_t i = 0; i < MAXSIZE / 100000; i++)
+	{
+		std::vector<order_line> v;
+		kapok::DeSerializer dr;
+		dr.Parse(json);
+		dr.Deserialize(v, "lines");
+		for (auto& line : v)
+			total += line.price;
+	}
+	double elapsed = tm.elapsed();
+
+	tm.restart();
+	for (size_t i = 0; i < MAXSIZE / 100000; i++)
+	{
+		rapidjson::StringStream ss(json.c_str());
+		kapok::for_each<order_line>(ss, "lines", [&total](order_line& line) { total += line.price; });
+	}
+	std::cout << "vector " << elapsed << " for_each " << tm.elapsed() << (total < 0 ? " " : "") << std::endl;
+}
+
+//a log of 200000 lines decoded on 1, 2, 4... threads up to the number of cores.
+void test_kapok_ndjson()
+{
+	std::string ndjson;
+	kapok::Serializer sr;
+	for (int i = 0; i < 200000; i++)
+	{
+		sr.Serialize(order_line{ i, i * 0.25, "request served" });
+		ndjson += sr.GetString();
+		ndjson += '\n';
+	}
+
+	const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+	for (size_t threads = 1; ; threads = std::min(threads * 2, cores))
+	{
+		boost::timer tm;
+		size_t count = 0;
+		for (size_t i = 0; i < MAXSIZE / 200000; i++)
+			count += kapok::parse_ndjson<order_line>(ndjson, threads).size();
+
+		std::cout << "ndjson " << threads << " threads " << tm.elapsed() << (count == 0 ? " " : "") << std::endl;
+		if (threads == cores)
+			break;
+	}
+}
+
+//a vector of 1000000 records written on 1, 2, 4... threads up to the number of cores.
+void test_kapok_parallel_serialize()
+{
+	std::vector<order_line> lines;
+	for (int i = 0; i < 1000000; i++)
+		lines.push_back(order_line{ i, i * 0.25, "exported line" });
+
+	const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+	for (size_t threads = 1; ; threads = std::min(threads * 2, cores))
+	{
+		kapok::Serializer sr;
+		sr.SetParallel(threads);
+		boost::timer tm;
+		for (size_t i = 0; i < MAXSIZE / 200000; i++)
+			sr.Serialize(lines, "lines");
+
+		std::cout << "parallel serialize " << threads << " threads " << tm.elapsed() << std::endl;
+		if (threads == cores)
+			break;
+	}
+}
+
+void test_kapok_parallel_deserialize()
+{
+	std::vector<order_line> lines;
+	for (int i = 0; i < 1000000; i++)
+		lines.push_back(order_line{ i, i * 0.25, "imported line" });
+
+	kapok::Serializer sr;
+	sr.Serialize(lines, "lines");
+	const std::string json = sr.GetString();
+
+	const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+	for (size_t threads = 1; ; threads = std::min(threads * 2, cores))
+	{
+		kapok::DeSerializer dr;
+		dr.SetParallel(threads);
+		dr.Parse(json);
+		boost::timer tm;
+		for (size_t i = 0; i < MAXSIZE / 200000; i++)
+		{
+			std::vector<order_line> result;
+			dr.Deserialize(result, "lines");
+		}
+
+		std::cout << "parallel deserialize " << threads << " threads " << tm.elapsed() << std::endl;
+		if (threads == cores)
+			break;
+	}
+}
+
+//reading the file into a string copies it twice (the string, then the copy parsed in place), the
+//mapping is parsed without a copy.
+void test_kapok_parse_file()
+{
+	std::vector<order_line> lines;
+	for (int i = 0; i < 1000000; i++)
+		lines.push_back(order_line{ i, i * 0.25, "mapped line" });
+
+	const char* path = "kapok_parse_file.json";
+	FILE* fp = std::fopen(path, "wb");
+	if (fp == nullptr)
+		return;
+
+	kapok::Serializer sr;
+	sr.Serialize(lines, "lines", fp);
+	std::fclose(fp);
+
+	kapok::DeSerializer dr;
+	boost::timer tm;
+	for (size_t i = 0; i < MAXSIZE / 200000; i++)
+	{
+		std::string text;
+		fp = std::fopen(path, "rb");
+		char buf[64 * 1024];
+		size_t n;
+		while ((n = std::fread(buf, 1, sizeof(buf), fp)) != 0)
+			text.append(buf, n);
+
+		std::fclose(fp);
+		dr.Parse(text);
+	}
+	std::cout << "parse file: read into a string " << tm.elapsed();
+
+	tm.restart();
+	for (size_t i = 0; i < MAXSIZE / 200000; i++)
+		dr.ParseFile(path);
+
+	std::cout << ", mapped " << tm.elapsed();
+
+	tm.restart();
+	for (size_t i = 0; i < MAXSIZE / 200000; i++)
+		dr.ParseFileInsitu(path);
+
+	std::cout << ", mapped in place " << tm.elapsed() << std::endl;
+	std::remove(path);
+}
+
+template<typename Find>
+double time_escape_scan(const std::string& text, Find find)
+{
+	const char* end = text.data() + text.size();
+	size_t found = 0;
+	boost::timer tm;
+	for (size_t i = 0; i < MAXSIZE / 10; i++)
+	{
+		for (const char* p = text.data(); p != end; ++p)
+		{
+			p = find(p, end);
+			found += p != end;
+			if (p == end)
+				break;
+		}
+	}
+	double elapsed = tm.elapsed();
+	return found == static_cast<size_t>(-1) ? 0 : elapsed;
+}
+
+void test_kapok_escape(const std::string& text, const char* name)
+{
+	kapok::Serializer sr;
+	boost::timer tm;
+	for (size_t i = 0; i < MAXSIZE / 10; i++)
+	{
+		sr.Serialize(text, "text");
+	}
+	std::cout << name << ": serialize " << tm.elapsed() << ", scan scalar " << time_escape_scan(text, kapok::detail::find_escape_scalar)
+		<< " simd " << time_escape_scan(text, kapok::detail::find_escape) << std::endl;
+}
+
+//long free text: without escapes, an escape every few bytes, and mostly utf-8.
+void test_kapok_string_escape()
+{
+	std::string plain;
+	std::string escapes;
+	std::string utf8;
+	while (plain.size() < 1024)
+	{
+		plain += "the quick brown fox jumps over the lazy dog. ";
+		escapes += "line\t\"quoted\"\n";
+		utf8 += "\xe4\xb8\xad\xe6\x96\x87\xe6\x97\xa5\xe5\xbf\x97 log ";
+	}
+
+	test_kapok_escape(plain, "escape-free");
+	test_kapok_escape(escapes, "escape-heavy");
+	test_kapok_escape(utf8, "utf-8");
+}
+
 void test_fmt()
 {
 	boost::timer tm;
@@ -133,6 +794,24 @@ int main(void) {
 
 	test_msgpack();
 	test_kapok();
+	test_kapok_sax();
+	test_kapok_field_lookup();
+	test_kapok_wide_record();
+	test_kapok_string_escape();
+	test_kapok_int_map();
+	test_kapok_nested_containers();
+	test_kapok_variant();
+	test_kapok_priority_queue();
+	test_kapok_float();
+	test_kapok_coordinates();
+	test_kapok_double_fallback();
+	test_kapok_insitu();
+	test_kapok_projection();
+	test_kapok_for_each();
+	test_kapok_ndjson();
+	test_kapok_parallel_serialize();
+	test_kapok_parallel_deserialize();
+	test_kapok_parse_file();
 
 	//test_msgpack_all();
 	//test_kapok_all();